@@ -2,27 +2,74 @@
 #include <stdio.h>
 #include <stdarg.h>  // for variadic fucntions: va_list, va_start
 #include <ctype.h>  // for isspace()...
+#include <string.h>  // for memmove()
+#include <errno.h>
+#include <unistd.h>  // for read()
+#include <fcntl.h>   // for open()
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdint.h>  // for SIZE_MAX, uintptr_t
+#include <stddef.h>  // for ptrdiff_t
+#include <stdlib.h>  // for malloc/free
+
+#include "my_scanf.h"   // Spec, ScanView, ScanArray and the kernel entry points
 
 /* =============================
    Parsing: Spec + parse_spec
    ============================= */
 
-typedef enum {
-    LEN_NONE,
-    LEN_HH,
-    LEN_H,
-    LEN_L,
-    LEN_LL,
-    LEN_CAP_L
-} Length;
+// Length and Spec are in my_scanf.h, shared with my_scanf.hpp.
 
-typedef struct {
-    int width;      // 0 means “no width specified”
-    Length len;     // hh, h, l, ll, L
-    char conv;      // 'd','s','c','x','f'; plus extensions q b r
-    int suppress;   // 0 = normal, 1 = assignment suppression via '*'
+// A scanset is a 256-bit table indexed by nibbles: byte c is bit (c >> 4) & 7
+// of set[(c & 15) | (c >> 7) << 4]. That is the layout a pshufb lookup
+// wants (see find_notin_ssse3), and a plain test is just as cheap.
+static inline int set_has(const unsigned char *set, int c) {
+    return (set[(c & 15) | (c >> 7) << 4] >> ((c >> 4) & 7)) & 1;
+}
+
+static inline void set_add(unsigned char *set, int c) {
+    set[(c & 15) | (c >> 7) << 4] |= (unsigned char)(1u << ((c >> 4) & 7));
+}
+
+// Fixed classes for the %*d / %*x / %*b / %*f skip paths, in the same
+// layout: '0'-'9' are row 3 of columns 0-9, 'A'-'F' row 4 and 'a'-'f'
+// row 6 of columns 1-6.
+static const unsigned char digit_set[32] = { 8, 8, 8, 8, 8, 8, 8, 8, 8, 8 };
+static const unsigned char hex_set[32] = { 0x08, 0x58, 0x58, 0x58, 0x58, 0x58, 0x58, 0x08, 0x08, 0x08 };
+static const unsigned char bin_set[32] = { 8, 8 };
+
+// Parses the scanset after "%[" up to its ']': "^" negates, a ']' right
+// after "[" or "[^" is a member, and "a-z" is a range ('-' first, last or
+// in a reversed range stands for itself). Returns 0 if there is no ']'.
+static int parse_set(const char **pp, unsigned char *set) {
+    const unsigned char *p = (const unsigned char *)*pp;
+    int negate = 0;
+    memset(set, 0, 32);
+    if (*p == '^') {
+        negate = 1;
+        p++;
+    }
+    if (*p == ']') set_add(set, *p++);
+    while (*p && *p != ']') {
+        if (p[1] == '-' && p[2] && p[2] != ']' && p[0] <= p[2]) {
+            for (int c = p[0]; c <= p[2]; c++) set_add(set, c);
+            p += 3;
+        } else {
+            set_add(set, *p++);
+        }
+    }
+    if (*p != ']') return 0;
+    if (negate) {
+        for (int i = 0; i < 32; i++) set[i] = (unsigned char)~set[i];
+    }
+    *pp = (const char *)(p + 1);
+    return 1;
+}
 
-} Spec;
+// Separators of array conversions (%8,d); '_' means whitespace only.
+static inline int is_array_delim(char c) {
+    return c == ',' || c == ';' || c == ':' || c == '|' || c == '_';
+}
 
 static int parse_spec(const char **pp, Spec *out) {
     const char *p = *pp;
@@ -31,18 +78,55 @@ static int parse_spec(const char **pp, Spec *out) {
     out->len = LEN_NONE;
     out->conv = '\0';
     out->suppress = 0;
-
-    // 0) assignment suppression
-    if (*p == '*') {
+    out->view = 0;
+    out->alloc = 0;
+    out->intern = 0;
+    out->count = 0;
+    out->delim = '\0';
+    out->prec = 0;
+
+    // 0) assignment suppression, or '*' and a separator: an array whose
+    //    count is an argument
+    if (*p == '*' && is_array_delim(p[1])) {
+        out->count = -1;
+        out->delim = p[1];
+        p += 2;
+    } else if (*p == '*') {
         out->suppress = 1;
         p++;
     }
 
-    // 1) width: one or more digits
+    // 1) width: one or more digits; followed by a separator they are an array count
     while (*p && isdigit((unsigned char)*p)) {
         out->width = out->width * 10 + (*p - '0');
         p++;
     }
+    if (out->count == 0 && out->width > 0 && is_array_delim(*p)) {
+        out->count = out->width;
+        out->width = 0;
+        out->delim = *p++;
+    }
+
+    // 1a) precision: fractional digits kept by %D
+    if (*p == '.') {
+        p++;
+        while (*p && isdigit((unsigned char)*p)) {
+            out->prec = out->prec * 10 + (*p - '0');
+            p++;
+        }
+    }
+
+    // 1b) view / allocation / intern flag
+    if (*p == 'v') {
+        out->view = 1;
+        p++;
+    } else if (*p == 'm') {
+        out->alloc = 1;
+        p++;
+    } else if (*p == 'I') {
+        out->intern = 1;
+        p++;
+    }
 
     // 2) length modifier 
     if (*p == 'h') {
@@ -66,6 +150,7 @@ static int parse_spec(const char **pp, Spec *out) {
     if (*p == '\0') return 0;
     out->conv = *p;
     p++;
+    if (out->conv == '[' && !parse_set(&p, out->set)) return 0;
 
     *pp = p;   // advance format pointer past the specifier
     return 1;
@@ -73,622 +158,4706 @@ static int parse_spec(const char **pp, Spec *out) {
 
 
 /* =============================
-   Input helpers: nextch/unreadch/skip_input_ws
+   Whitespace kernels: find_ws / find_nonws, find_notin for scansets and
+   find_qesc for quoted strings
+   Whitespace is the C-locale set: ' ', \t \n \v \f \r.
+   SSE2/AVX2 versions look at 16/32 bytes per step; the AVX2 one is
+   picked at runtime when the CPU supports it, otherwise SSE2 (x86-64)
+   or the scalar loop. find_notin needs pshufb, so without AVX2 it is
+   SSSE3 or scalar.
    ============================= */
 
-#define UNREAD_MAX 16
-static int ubuf[UNREAD_MAX];
-static int ubuf_len = 0;
-
-static int nextch(void) {
-    if (ubuf_len > 0) {
-        return ubuf[--ubuf_len];
-    }
-    return getchar();
+static inline int is_ws(int c) {
+    return c == ' ' || (unsigned)(c - '\t') <= (unsigned)('\r' - '\t');
 }
 
-static void unreadch(int c) {
-    if (c == EOF) return;
-    if (ubuf_len < UNREAD_MAX) {
-        ubuf[ubuf_len++] = c;
-    }
+typedef const unsigned char *(*FindFn)(const unsigned char *p, const unsigned char *end);
+typedef const unsigned char *(*FindSetFn)(const unsigned char *set, const unsigned char *p,
+                                          const unsigned char *end);
+
+// first whitespace byte in [p, end), or end
+static const unsigned char *find_ws_scalar(const unsigned char *p, const unsigned char *end) {
+    while (p < end && !is_ws(*p)) p++;
+    return p;
 }
 
-static void skip_input_ws(void) {
-int c;
-while ((c = nextch()) != EOF) {
-    if (!isspace((unsigned char)c)) {
-        unreadch(c);
-        return;
-    }
+// first non-whitespace byte in [p, end), or end
+static const unsigned char *find_nonws_scalar(const unsigned char *p, const unsigned char *end) {
+    while (p < end && is_ws(*p)) p++;
+    return p;
 }
+
+// first '"' or '\\' in [p, end), or end
+static const unsigned char *find_qesc_scalar(const unsigned char *p, const unsigned char *end) {
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
 }
 
+// first byte in [p, end) that is not in the scanset, or end
+static const unsigned char *find_notin_scalar(const unsigned char *set, const unsigned char *p,
+                                              const unsigned char *end) {
+    while (p < end && set_has(set, *p)) p++;
+    return p;
+}
 
-/* =============================
-   Conversions: scan_c scan_s scan_d scan_x scan_f
-   ============================= */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
 
-// %c: reads 1 character (or width characters); does not skip whitespace; not null-terminated
-static int scan_c(const Spec *sp, va_list *ap) {
-    int n = (sp->width == 0) ? 1 : sp->width;
+static inline __m128i ws_mask_sse2(__m128i v) {
+    // ' ' or (v - '\t') <= 4 as unsigned bytes
+    __m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t);
+    return _mm_or_si128(sp, ctl);
+}
 
-    char *out = NULL;
-    if (!sp->suppress) out = va_arg(*ap, char*);
+static const unsigned char *find_ws_sse2(const unsigned char *p, const unsigned char *end) {
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned m = (unsigned)_mm_movemask_epi8(ws_mask_sse2(v));
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
+    }
+    return find_ws_scalar(p, end);
+}
 
-    for (int i = 0; i < n; i++) {
-        int c = nextch();
-        if (c == EOF) return 0;
-        if (!sp->suppress) out[i] = (char)c;
+static const unsigned char *find_nonws_sse2(const unsigned char *p, const unsigned char *end) {
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned m = ~(unsigned)_mm_movemask_epi8(ws_mask_sse2(v)) & 0xFFFFu;
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
     }
+    return find_nonws_scalar(p, end);
+}
 
-    return 1;
+__attribute__((target("avx2")))
+static inline __m256i ws_mask_avx2(__m256i v) {
+    __m256i sp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(4)), t);
+    return _mm256_or_si256(sp, ctl);
 }
 
+__attribute__((target("avx2")))
+static const unsigned char *find_ws_avx2(const unsigned char *p, const unsigned char *end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned m = (unsigned)_mm256_movemask_epi8(ws_mask_avx2(v));
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+    return find_ws_sse2(p, end);
+}
 
-static int scan_s(const Spec *sp, va_list *ap) {
-    // %s skips leading whitespace
-    skip_input_ws();
+__attribute__((target("avx2")))
+static const unsigned char *find_nonws_avx2(const unsigned char *p, const unsigned char *end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned m = ~(unsigned)_mm256_movemask_epi8(ws_mask_avx2(v));
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+    return find_nonws_sse2(p, end);
+}
 
-    char *out = NULL;
-    if (!sp->suppress)
-        out = va_arg(*ap, char*);
+// Quoted strings are mostly short, so the tail matters: it is one load
+// too, when that cannot cross into the next page, with the bytes past end
+// masked off. Reading them is harmless but looks like an overflow to ASan.
+__attribute__((no_sanitize_address))
+static inline unsigned qesc_mask_sse2(const unsigned char *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    return (unsigned)_mm_movemask_epi8(hit);
+}
 
-    int i = 0;
-    int limit = sp->width;   // 0 means “no limit”
+__attribute__((no_sanitize_address))
+static const unsigned char *find_qesc_sse2(const unsigned char *p, const unsigned char *end) {
+    while (end - p >= 16) {
+        unsigned m = qesc_mask_sse2(p);
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
+    }
+    if (p < end && ((uintptr_t)p & 4095) <= 4096 - 16) {
+        unsigned m = qesc_mask_sse2(p) & ((1u << (end - p)) - 1);
+        return m ? p + __builtin_ctz(m) : end;
+    }
+    return find_qesc_scalar(p, end);
+}
 
-    int c = nextch();
-    if (c == EOF) return 0;
+__attribute__((target("avx2"), no_sanitize_address))
+static inline unsigned qesc_mask_avx2(const unsigned char *p) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+    return (unsigned)_mm256_movemask_epi8(hit);
+}
 
-    // If the next character is whitespace (or EOF), %s fails
-    if (isspace((unsigned char)c)) {
-        unreadch(c);
-        return 0;
+// 64 bytes per step: two compares folded into one 64-bit mask
+__attribute__((target("avx2"), no_sanitize_address))
+static const unsigned char *find_qesc_avx2(const unsigned char *p, const unsigned char *end) {
+    while (end - p >= 64) {
+        uint64_t m = qesc_mask_avx2(p) | (uint64_t)qesc_mask_avx2(p + 32) << 32;
+        if (m) return p + __builtin_ctzll(m);
+        p += 64;
     }
-
-    // Read until whitespace or EOF
-    while (c != EOF && !isspace((unsigned char)c)) {
-        // store only if not suppressed, and only up to width
-        if (limit == 0 || i < limit) {
-            if (!sp->suppress) out[i] = (char)c;
-            i++;
-        } else {
-            // width reached: stop scanning token and leave this char for next read
-            unreadch(c);
-            break;
-        }
-        c = nextch();
+    if (end - p >= 32) {
+        unsigned m = qesc_mask_avx2(p);
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+    if (p < end && ((uintptr_t)p & 4095) <= 4096 - 32) {
+        unsigned m = qesc_mask_avx2(p) & (0xFFFFFFFFu >> (32 - (end - p)));
+        return m ? p + __builtin_ctz(m) : end;
     }
+    return find_qesc_sse2(p, end);
+}
 
-    // if we stopped because of whitespace, put it back for the next conversion
-    if (c != EOF && isspace((unsigned char)c)) unreadch(c);
+// Scanset membership, 16 bytes at a time: pshufb picks each byte's row of
+// the table by its low nibble (rows 0-7 from set[0..15] for bytes < 0x80,
+// rows 8-15 from set[16..31] for the rest, since pshufb zeroes lanes whose
+// index has the top bit set), and a second pshufb turns bits 4-6 into the
+// bit to test in that row.
+__attribute__((target("ssse3")))
+static inline __m128i set_mask_ssse3(__m128i v, __m128i lo, __m128i hi) {
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m128i row = _mm_or_si128(_mm_shuffle_epi8(lo, v),
+                               _mm_shuffle_epi8(hi, _mm_xor_si128(v, _mm_set1_epi8(-128))));
+    __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(7)));
+    return _mm_cmpeq_epi8(_mm_and_si128(row, bit), bit);
+}
 
-    if (!sp->suppress) {
-        // null-terminate; caller must provide at least (min(tokenlen,width)+1) space
-        int term = (limit == 0) ? i : (i < limit ? i : limit);
-        out[term] = '\0';
+__attribute__((target("ssse3")))
+static const unsigned char *find_notin_ssse3(const unsigned char *set, const unsigned char *p,
+                                             const unsigned char *end) {
+    __m128i lo = _mm_loadu_si128((const __m128i *)set);
+    __m128i hi = _mm_loadu_si128((const __m128i *)(set + 16));
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned m = ~(unsigned)_mm_movemask_epi8(set_mask_ssse3(v, lo, hi)) & 0xFFFFu;
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
     }
-
-    return 1;
+    return find_notin_scalar(set, p, end);
 }
 
+__attribute__((target("avx2")))
+static const unsigned char *find_notin_avx2(const unsigned char *set, const unsigned char *p,
+                                            const unsigned char *end) {
+    // vpshufb looks up within each 128-bit lane, so both lanes get the same tables
+    const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                          1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set));
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(set + 16)));
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i row = _mm256_or_si256(_mm256_shuffle_epi8(lo, v),
+                                      _mm256_shuffle_epi8(hi, _mm256_xor_si256(v, _mm256_set1_epi8(-128))));
+        __m256i bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(7)));
+        unsigned m = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+    return find_notin_ssse3(set, p, end);
+}
+#endif
+
+// chosen once at load time; scalar until then
+static FindFn find_ws = find_ws_scalar;
+static FindFn find_nonws = find_nonws_scalar;
+static FindSetFn find_notin = find_notin_scalar;
+static FindFn find_qesc = find_qesc_scalar;
+
+__attribute__((constructor))
+static void pick_kernels(void) {
+#ifdef HAVE_X86_KERNELS
+    if (__builtin_cpu_supports("avx2")) {
+        find_ws = find_ws_avx2;
+        find_nonws = find_nonws_avx2;
+        find_notin = find_notin_avx2;
+        find_qesc = find_qesc_avx2;
+    } else {
+        find_ws = find_ws_sse2;
+        find_nonws = find_nonws_sse2;
+        find_qesc = find_qesc_sse2;
+        if (__builtin_cpu_supports("ssse3")) find_notin = find_notin_ssse3;
+    }
+#endif
+}
 
-static int scan_d(const Spec *sp, va_list *ap) {
-    // %d skips leading whitespace
-    skip_input_ws();
 
-    int limit = sp->width;   // 0 = no limit
-    int used = 0;
+/* =============================
+   Arena: storage for %m conversions
+   Strings are bump-allocated from a chain of blocks and all released by
+   one reset; the blocks stay around for the next batch.
+   ============================= */
 
-    int c = nextch();
-    if (c == EOF) return 0;
+#define ARENA_BLOCK (64 * 1024)
 
-    int sign = 1;
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t cap;
+    size_t used;
+    char data[];
+} ArenaBlock;
 
-    // optional sign
-    if (c == '+' || c == '-') {
-        if (c == '-') sign = -1;
-        c = nextch();
-        if (c == EOF) return 0;
+typedef struct {
+    ArenaBlock *head;
+    ArenaBlock *cur;    // block the open string is written to; later blocks are empty
+} Arena;
+
+// Makes room for need bytes of the open string (the bytes after cur->used),
+// moving the keep bytes already written to a new block if cur is too small.
+static int arena_reserve(Arena *a, size_t keep, size_t need) {
+    ArenaBlock *b = a->cur;
+    if (b && b->cap - b->used >= need) return 1;
+
+    ArenaBlock *next = b ? b->next : a->head;
+    if (!next || next->cap < need) {
+        size_t cap = ARENA_BLOCK;
+        while (cap < need) cap *= 2;
+        ArenaBlock *nb = malloc(sizeof *nb + cap);
+        if (!nb) return 0;
+        nb->cap = cap;
+        nb->used = 0;
+        nb->next = next;
+        if (b) b->next = nb;
+        else a->head = nb;
+        next = nb;
     }
+    if (keep > 0) memcpy(next->data, b->data + b->used, keep);
+    a->cur = next;
+    return 1;
+}
 
-    // must have at least one digit
-    if (!isdigit((unsigned char)c)) {
-        unreadch(c);
-        return 0;
-    }
+static inline char *arena_open(Arena *a) {
+    return a->cur->data + a->cur->used;
+}
 
-    long value = 0; // use long internally to reduce overflow risk while building
+// free bytes for the open string
+static inline size_t arena_room(Arena *a) {
+    return a->cur ? a->cur->cap - a->cur->used : 0;
+}
 
-    while (c != EOF && isdigit((unsigned char)c)) {
-        if (limit != 0 && used >= limit) {
-                unreadch(c);
-                break;
-            }
-        value = value * 10 + (c - '0');
-        used++;
-        c = nextch();
-    }
+static inline void arena_commit(Arena *a, size_t n) {
+    a->cur->used += n;
+}
 
-    // we've read one char too far (non-digit or EOF)
-    if (c != EOF && !(limit != 0 && used >= limit)) unreadch(c);
+typedef struct {
+    ArenaBlock *cur;
+    size_t used;
+} ArenaMark;
 
-    if (sp->suppress) {
-    return 1;   
-    }
+static ArenaMark arena_mark(const Arena *a) {
+    ArenaMark m = { a->cur, a->cur ? a->cur->used : 0 };
+    return m;
+}
 
-    long signed_value = sign * value;
+static void arena_reset(Arena *a);
 
-    switch (sp->len) {
-        case LEN_NONE: {
-            int *out = va_arg(*ap, int*);
-            *out = (int)signed_value;
-            break;
-        }
-        case LEN_L: {
-            long *out = va_arg(*ap, long*);
-            *out = (long)signed_value;
-            break;
-        }
-        case LEN_LL: {
-            long long *out = va_arg(*ap, long long*);
-            *out = (long long)signed_value;
-            break;
-        }
-        default:
-            // unsupported length for %d
-            return 0;
+// Frees everything allocated since m.
+static void arena_rewind(Arena *a, ArenaMark m) {
+    if (!m.cur) {
+        arena_reset(a);
+        return;
     }
-
-    return 1;
+    for (ArenaBlock *b = m.cur->next; b; b = b->next) b->used = 0;
+    m.cur->used = m.used;
+    a->cur = m.cur;
 }
 
-
-static int hex_value(int c) {
-    if ('0' <= c && c <= '9') return c - '0';
-    if ('a' <= c && c <= 'f') return 10 + (c - 'a');
-    if ('A' <= c && c <= 'F') return 10 + (c - 'A');
-    return -1;
+static void arena_reset(Arena *a) {
+    for (ArenaBlock *b = a->head; b; b = b->next) b->used = 0;
+    a->cur = a->head;
 }
 
-static int scan_x(const Spec *sp, va_list *ap) {
-    // %x skips leading whitespace
-    skip_input_ws();
-
-    int limit = sp->width;  // 0 = no limit
-    int used = 0;
+static void arena_free(Arena *a) {
+    ArenaBlock *b = a->head;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head = NULL;
+    a->cur = NULL;
+}
 
-    int c = nextch();
-    if (c == EOF) return 0;
-    used++;
 
-    // Optional 0x / 0X prefix
-    if (c == '0') {
-        if (limit == 0 || used < limit) {
-            int c2 = nextch();
-            if (c2 == EOF) return 0;
-            used++;    
+/* =============================
+   Intern table: storage for %Is conversions
+   Each distinct token gets a small ID, in order of first appearance, and
+   one canonical copy. The hash index is open-addressed with linear
+   probing; a slot keeps the top half of the hash next to the ID so that
+   a probe rarely has to look at the text.
+   ============================= */
 
-            if (c2 == 'x' || c2 == 'X') {
-                // we consumed "0x"; now read the first digit (if width allows)
-                if (limit != 0 && used >= limit) {
-                    // width ended exactly after 'x' → no digits allowed → fail
-                    unreadch(c2); used--;
-                    unreadch(c);  used--;
-                    return 0;
-                }
+typedef struct {
+    const char *ptr;    // NUL-terminated copy in text
+    size_t len;
+} InternEntry;
 
-                c = nextch();
-                if (c == EOF) return 0;
-                used++; 
-            } else {
-                unreadch(c2);
-                used--; 
-            }
-        }
+typedef struct {
+    uint64_t *slots;    // hash >> 32 << 32 | (id + 1); 0 = empty
+    size_t mask;        // slots has mask + 1 entries, a power of two
+    InternEntry *entries;
+    unsigned count;
+    unsigned cap;
+    Arena text;
+} Interner;
+
+// The first and last words of p[0..n), overlapping when n < 16, so a
+// token is read with two fixed-size loads and never past its end.
+static inline void intern_words(const unsigned char *p, size_t n, uint64_t *a, uint64_t *b) {
+    if (n >= 8) {
+        memcpy(a, p, 8);
+        memcpy(b, p + n - 8, 8);
+    } else if (n >= 4) {
+        uint32_t x, y;
+        memcpy(&x, p, 4);
+        memcpy(&y, p + n - 4, 4);
+        *a = x;
+        *b = y;
+    } else {
+        *a = n ? (uint64_t)p[0] << 16 | (uint64_t)p[n / 2] << 8 | p[n - 1] : 0;
+        *b = 0;
     }
+}
 
-    // Must have at least one hex digit
-    int hv = hex_value(c);
-    if (hv < 0) {
-        unreadch(c);
-        used--; 
-        return 0;
+// 64-bit hash of p[0..n): 8-byte words through a multiply-xorshift mix.
+static uint64_t intern_hash(const unsigned char *p, size_t n) {
+    const uint64_t k = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = n * k;
+    uint64_t a, b, w;
+    intern_words(p, n, &a, &b);
+    for (size_t i = 8; i + 8 < n; i += 8) {    // the words between, for long tokens
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * k;
+        h ^= h >> 29;
     }
+    h = (h ^ a) * k;
+    h ^= h >> 29;
+    h = (h ^ b) * k;
+    h ^= h >> 32;
+    h *= k;
+    return h ^ (h >> 29);
+}
 
-    unsigned long value = 0;
+static inline int intern_eq(const char *x, const char *y, size_t n) {
+    if (n > 16) return memcmp(x, y, n) == 0;
+    uint64_t xa, xb, ya, yb;
+    intern_words((const unsigned char *)x, n, &xa, &xb);
+    intern_words((const unsigned char *)y, n, &ya, &yb);
+    return xa == ya && xb == yb;
+}
 
-    while (c != EOF && (hv = hex_value(c)) >= 0) {
-        if (limit != 0 && used > limit) {
-            unreadch(c);
-            used--;
-            break;
-        }
-        value = value * 16 + (unsigned long)hv;
-        
-        c = nextch();
-        if (c == EOF) break;
-        used++;
+// Rebuilds the index with twice the slots (16 to start).
+static int intern_grow(Interner *t) {
+    size_t n = t->slots ? (t->mask + 1) * 2 : 16;
+    uint64_t *slots = calloc(n, sizeof *slots);
+    if (!slots) return 0;
+    for (unsigned id = 0; id < t->count; id++) {
+        uint64_t h = intern_hash((const unsigned char *)t->entries[id].ptr, t->entries[id].len);
+        size_t i = (size_t)h & (n - 1);
+        while (slots[i]) i = (i + 1) & (n - 1);
+        slots[i] = (h >> 32 << 32) | (id + 1);
     }
+    free(t->slots);
+    t->slots = slots;
+    t->mask = n - 1;
+    return 1;
+}
 
-    // If we stopped because of a non-hex char, put it back for the next conversion
-    if (c != EOF && hex_value(c) < 0) {
-        unreadch(c);
-        used--;
+// ID of p[0..n), added if it is new; -1 if out of memory.
+static long intern(Interner *t, const char *p, size_t n) {
+    if ((size_t)t->count * 2 >= t->mask && !intern_grow(t)) return -1;   // load stays under 1/2
+
+    uint64_t h = intern_hash((const unsigned char *)p, n);
+    uint64_t tag = h >> 32 << 32;
+    size_t i = (size_t)h & t->mask;
+    for (; t->slots[i]; i = (i + 1) & t->mask) {
+        if ((t->slots[i] & ~0xFFFFFFFFULL) != tag) continue;
+        const InternEntry *e = &t->entries[(t->slots[i] & 0xFFFFFFFFu) - 1];
+        if (e->len == n && intern_eq(e->ptr, p, n)) return (long)((t->slots[i] & 0xFFFFFFFFu) - 1);
     }
 
-    if (sp->suppress) return 1;   
-
-    switch (sp->len) {
-        case LEN_NONE: {
-            unsigned int *out = va_arg(*ap, unsigned int*);
-            *out = (unsigned int)value;
-            break;
-        }
-        case LEN_L: {
-            unsigned long *out = va_arg(*ap, unsigned long*);
-            *out = (unsigned long)value;
-            break;
-        }
-        case LEN_LL: {
-            unsigned long long *out = va_arg(*ap, unsigned long long*);
-            *out = (unsigned long long)value;
-            break;
-        }
-        default:
-            return 0;
+    if (t->count == UINT32_MAX - 1) return -1;
+    if (t->count == t->cap) {
+        unsigned cap = t->cap ? t->cap * 2 : 16;
+        InternEntry *entries = realloc(t->entries, cap * sizeof *entries);
+        if (!entries) return -1;
+        t->entries = entries;
+        t->cap = cap;
     }
-
-    return 1;
+    if (!arena_reserve(&t->text, 0, n + 1)) return -1;
+    char *copy = arena_open(&t->text);
+    memcpy(copy, p, n);
+    copy[n] = '\0';
+    arena_commit(&t->text, n + 1);
+
+    unsigned id = t->count++;
+    t->entries[id].ptr = copy;
+    t->entries[id].len = n;
+    t->slots[i] = tag | (id + 1);
+    return id;
 }
 
-static long double pow10_ld(int exp) {
-    long double p = 1.0L;
-    if (exp >= 0) {
-        for (int i = 0; i < exp; i++) p *= 10.0L;
-    } else {
-        for (int i = 0; i < -exp; i++) p /= 10.0L;
-    }
-    return p;
+static void intern_free(Interner *t) {
+    free(t->slots);
+    free(t->entries);
+    arena_free(&t->text);
+    memset(t, 0, sizeof *t);
 }
 
-static int scan_f(const Spec *sp, void *outp) {
-    skip_input_ws();
 
-    int limit = sp->width;   // 0 = no limit
-    int used = 0;
+/* =============================
+   Input helpers: nextch/unreadch/skip_input_ws, ctx_mark/ctx_rewind
+   ============================= */
 
-    #define READC() ((limit!=0 && used>=limit) ? EOF : (used++, nextch()))
-    #define UNRDC(ch) do { if ((ch)!=EOF) { unreadch(ch); used--; } } while(0)
+// Input is read in large blocks; nextch/unreadch are cursor moves inside
+// the block. Going back further than the byte just read takes a mark:
+// while a mark is held, refill() keeps every byte from it on (growing the
+// buffer if it must), so ctx_rewind can return to it in one step however
+// far the scan has looked ahead. Without marks or views, refill keeps
+// nothing before the cursor.
+//
+// All of it lives in a ScanCtx, so separate contexts can be used from
+// separate threads; my_scanf uses a per-thread context on stdin.
+//
+// Sources: an fd (read(2)), a FILE* (fread), or memory. Memory and mmap
+// sources are scanned in place: buf points at the caller's bytes (or the
+// mapping), the whole input is one block and refill never copies.
+#define INBUF_SIZE (64 * 1024)
+
+#ifndef MY_SCANF_STATS
+#define MY_SCANF_STATS 0    // 1: count conversions (see "Instrumentation")
+#endif
+#define NO_HOLD UINT64_MAX
 
-    int c = READC();
-    if (c == EOF) return 0;
+typedef enum {
+    SRC_FD,
+    SRC_FILE,
+    SRC_MEM,
+    SRC_MMAP,
+    SRC_PUSH        // bytes arrive through my_scanf_feed
+} SrcKind;
+
+struct ScanCtx {
+    unsigned char *buf; // never written for SRC_MEM / SRC_MMAP
+    size_t cap;
+    size_t pos;         // next byte to hand out
+    size_t len;         // number of valid bytes in buf
+    uint64_t base;      // stream offset of buf[0]
+    int eof;            // source is exhausted (or failed): no more input
+
+    SrcKind src;
+    int fd;             // SRC_FD
+    FILE *fp;           // SRC_FILE
+    size_t chunk;       // SRC_FILE: bytes to ask for on the next refill
+    int own_buf;        // buf was malloc'ed by us
+
+    uint64_t hold;      // stream offset of the oldest mark held, or NO_HOLD
+
+    int overflow_policy;    // MY_SCANF_OVERFLOW_*
+    int frac_policy;        // MY_SCANF_FRAC_*: %.ND input with more than N fractional digits
+
+    // views handed out since the current call started; refill keeps the
+    // buffer from views[0] on and moves the pointers along with the bytes
+    ScanView **views;
+    size_t nviews;
+    size_t views_cap;
+    int transient;      // buffer does not outlive the call (my_fscanf): no views
+    int starved;        // SRC_PUSH: a read ran past the bytes fed so far
+
+    Arena *arena;       // where %m strings go; NULL: %m fails
+    Arena own_arena;    // contexts from my_scanf_ctx_new* and the per-thread one
+    Interner *interner; // where %Is tokens go; NULL: %Is fails
+    Interner own_interner;
+
+#if MY_SCANF_STATS
+    unsigned pb_count;  // characters given back since the conversion started
+#endif
+};
+
+#define MY_SCANF_OVERFLOW_FAIL     0   // out-of-range value: conversion fails, errno = ERANGE
+#define MY_SCANF_OVERFLOW_SATURATE 1   // out-of-range value: store the type's min/max, errno = ERANGE
+
+#define MY_SCANF_FRAC_REJECT   0   // digits past the scale must all be 0, else the conversion fails
+#define MY_SCANF_FRAC_TRUNCATE 1   // digits past the scale are dropped
+#define MY_SCANF_FRAC_ROUND    2   // rounded to the scale, ties to even
+
+static void ctx_init(ScanCtx *ctx, SrcKind src, unsigned char *buf, size_t cap) {
+    ctx->buf = buf;
+    ctx->cap = cap;
+    ctx->pos = 0;
+    ctx->len = 0;
+    ctx->base = 0;
+    ctx->eof = 0;
+    ctx->src = src;
+    ctx->fd = -1;
+    ctx->fp = NULL;
+    ctx->chunk = cap;
+    ctx->own_buf = 0;
+    ctx->hold = NO_HOLD;
+    ctx->overflow_policy = MY_SCANF_OVERFLOW_FAIL;
+    ctx->frac_policy = MY_SCANF_FRAC_REJECT;
+    ctx->views = NULL;
+    ctx->nviews = 0;
+    ctx->views_cap = 0;
+    ctx->transient = 0;
+    ctx->starved = 0;
+    ctx->arena = NULL;
+    ctx->own_arena.head = NULL;
+    ctx->own_arena.cur = NULL;
+    ctx->interner = NULL;
+    memset(&ctx->own_interner, 0, sizeof ctx->own_interner);
+#if MY_SCANF_STATS
+    ctx->pb_count = 0;
+#endif
+}
 
-    int sign = 1;
-    if (c == '+' || c == '-') {
-        if (c == '-') sign = -1;
-        c = READC();
-        if (c == EOF) return 0;
-    }
+// The whole input is [data, data+len); nothing is copied.
+static void ctx_init_mem(ScanCtx *ctx, const char *data, size_t len) {
+    ctx_init(ctx, SRC_MEM, (unsigned char *)data, len);
+    ctx->len = len;
+    ctx->eof = 1;
+}
 
-    int saw_digit = 0;
-    long double val = 0.0L;
+// Moves every live view by delta bytes, after the buffer moved under them.
+static void ctx_rebase_views(ScanCtx *ctx, ptrdiff_t delta) {
+    for (size_t i = 0; i < ctx->nviews; i++) ctx->views[i]->ptr += delta;
+}
 
-    while (c != EOF && isdigit((unsigned char)c)) {
-        saw_digit = 1;
-        val = val * 10.0L + (long double)(c - '0');
-        c = READC();
-    }
+// Doubles the buffer, keeping its contents; a caller-provided buffer is
+// replaced by a malloc'ed one.
+static int ctx_grow(ScanCtx *ctx) {
+    size_t cap = ctx->cap * 2;
+    unsigned char *buf = malloc(cap);
+    if (!buf) return 0;
+    memcpy(buf, ctx->buf, ctx->len);
+    ctx_rebase_views(ctx, (const char *)buf - (const char *)ctx->buf);
+    if (ctx->own_buf) free(ctx->buf);
+    ctx->buf = buf;
+    ctx->cap = cap;
+    ctx->own_buf = 1;
+    return 1;
+}
 
-    if (c == '.') {
-        long double place = 0.1L;
-        c = READC();
-        while (c != EOF && isdigit((unsigned char)c)) {
-            saw_digit = 1;
-            val += (long double)(c - '0') * place;
-            place *= 0.1L;
-            c = READC();
-        }
+// The first byte of buf still needed: the cursor, the oldest mark held,
+// or the first byte of a live view, whichever comes first.
+static size_t ctx_keep_from(const ScanCtx *ctx) {
+    size_t from = ctx->pos;
+    if (ctx->hold != NO_HOLD && ctx->hold - ctx->base < from) from = (size_t)(ctx->hold - ctx->base);
+    if (ctx->nviews > 0) {
+        size_t v = (size_t)((const unsigned char *)ctx->views[0]->ptr - ctx->buf);
+        if (v < from) from = v;
     }
+    return from;
+}
 
-    if (!saw_digit) {
-        UNRDC(c);
+static int refill(ScanCtx *ctx) {
+    if (ctx->eof) return 0;
+    if (ctx->src == SRC_PUSH) {
+        ctx->starved = 1;   // nothing to read until the next my_scanf_feed
         return 0;
     }
 
-    if (c == 'e' || c == 'E') {
-        int e_char = c;
-        int exp_sign = 1;
-        int exp_val = 0;
-
-        int c2 = READC();
-        if (c2 == '+' || c2 == '-') {
-            if (c2 == '-') exp_sign = -1;
-            int c3 = READC();
-            if (c3 == EOF || !isdigit((unsigned char)c3)) {
-                UNRDC(c3);
-                UNRDC(c2);
-                UNRDC(e_char);
-            } else {
-                exp_val = c3 - '0';
-                int cx = READC();
-                while (cx != EOF && isdigit((unsigned char)cx)) {
-                    exp_val = exp_val * 10 + (cx - '0');
-                    cx = READC();
-                }
-                UNRDC(cx);
-                val *= pow10_ld(exp_sign * exp_val);
-                c = READC();
-            }
-        } else if (c2 == EOF || !isdigit((unsigned char)c2)) {
-            UNRDC(c2);
-            UNRDC(e_char);
-        } else {
-            exp_val = c2 - '0';
-            int cx = READC();
-            while (cx != EOF && isdigit((unsigned char)cx)) {
-                exp_val = exp_val * 10 + (cx - '0');
-                cx = READC();
-            }
-            UNRDC(cx);
-            val *= pow10_ld(exp_sign * exp_val);
-            c = READC();
+    size_t from = ctx_keep_from(ctx);
+    if (from > 0) {
+        memmove(ctx->buf, ctx->buf + from, ctx->len - from);
+        ctx_rebase_views(ctx, -(ptrdiff_t)from);
+        ctx->base += from;
+        ctx->pos -= from;
+        ctx->len -= from;
+    }
+    if (ctx->len == ctx->cap && !ctx_grow(ctx)) return 0;
+
+    size_t room = ctx->cap - ctx->len;
+    if (ctx->src == SRC_FILE) {
+        if (room > ctx->chunk) room = ctx->chunk;
+        size_t n = fread(ctx->buf + ctx->len, 1, room, ctx->fp);
+        if (n == 0) {
+            ctx->eof = 1;
+            return 0;
         }
+        ctx->len += n;
+        // seekable streams start small and grow; byte-at-a-time ones (chunk 1) stay that way
+        if (ctx->chunk > 1 && ctx->chunk < ctx->cap) ctx->chunk *= 2;
+        return 1;
     }
 
-    // Only unread if it is NOT whitespace (and not EOF)
-    if (c != EOF && !isspace((unsigned char)c)) {
-        UNRDC(c);
+    for (;;) {
+        ssize_t n = read(ctx->fd, ctx->buf + ctx->len, room);
+        if (n > 0) {
+            ctx->len += (size_t)n;
+            return 1;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        ctx->eof = 1;
+        return 0;
     }
+}
 
-    if (sp->suppress) {
-        return 1;   
-    }
+static inline int nextch(ScanCtx *ctx) {
+    if (ctx->pos == ctx->len && !refill(ctx)) return EOF;
+    return ctx->buf[ctx->pos++];
+}
 
-    val *= (long double)sign;
+// Gives back c, which must be the byte nextch just returned (or EOF, which
+// is ignored). That byte is always still in the buffer.
+static inline void unreadch(ScanCtx *ctx, int c) {
+    if (c == EOF) return;
+#if MY_SCANF_STATS
+    ctx->pb_count++;
+#endif
+    ctx->pos--;
+}
 
-    if (sp->len == LEN_NONE) {          // %f
-        *(float*)outp = (float)val;
-    } else if (sp->len == LEN_L) {      // %lf
-        *(double*)outp = (double)val;
-    } else if (sp->len == LEN_CAP_L) {  // %Lf
-        *(long double*)outp = (long double)val;
-    } else {
-        #undef READC
-        #undef UNRDC
-        return 0;
-    }
-    
-    #undef READC
-    #undef UNRDC
-    return 1;
+// A point to come back to. Marks nest: release them in reverse order.
+typedef struct {
+    uint64_t at;        // stream offset of the cursor when it was taken
+    uint64_t outer;     // ctx->hold before this mark
+} ScanMark;
+
+static inline ScanMark ctx_mark(ScanCtx *ctx) {
+    ScanMark m = { ctx->base + ctx->pos, ctx->hold };
+    if (m.at < ctx->hold) ctx->hold = m.at;
+    return m;
 }
 
+// Moves the cursor back to m, which must still be held.
+static inline void ctx_rewind(ScanCtx *ctx, ScanMark m) {
+    size_t pos = (size_t)(m.at - ctx->base);
+#if MY_SCANF_STATS
+    ctx->pb_count += (unsigned)(ctx->pos - pos);
+#endif
+    ctx->pos = pos;
+}
 
-/* =============================
-   Extensions: scan_q scan_b scan_r
-   ============================= */
+// Lets refill drop the bytes m was holding.
+static inline void ctx_release(ScanCtx *ctx, ScanMark m) {
+    ctx->hold = m.outer;
+}
 
-// %q: reads a quoted string (text inside double quotes), or behaves like %s if not quote
-static int scan_q(const Spec *sp, va_list *ap) {
-    char *out = NULL;
-    if (!sp->suppress) out = va_arg(*ap, char*);
+static void skip_input_ws(ScanCtx *ctx) {
+    for (;;) {
+        ctx->pos = (size_t)(find_nonws(ctx->buf + ctx->pos, ctx->buf + ctx->len) - ctx->buf);
+        if (ctx->pos < ctx->len) return;
+        if (!refill(ctx)) return;
+    }
+}
 
-    skip_input_ws();
+// Reads a run of non-whitespace bytes (at most limit) into out, if out is
+// not NULL. Whole runs are located with find_ws and copied in one block.
+// Returns the number of bytes consumed; the byte that stopped it stays unread.
+static size_t read_token(ScanCtx *ctx, char *out, size_t limit) {
+    size_t i = 0;
+
+    while (i < limit) {
+        if (ctx->pos == ctx->len && !refill(ctx)) break;
+
+        const unsigned char *p = ctx->buf + ctx->pos;
+        const unsigned char *end = ctx->buf + ctx->len;
+        if ((size_t)(end - p) > limit - i) end = p + (limit - i);
+
+        const unsigned char *stop = find_ws(p, end);
+        size_t n = (size_t)(stop - p);
+        if (out) memcpy(out + i, p, n);
+        i += n;
+        ctx->pos += n;
+        if (stop < ctx->buf + ctx->len) break;   // hit whitespace or width
+    }
+    return i;
+}
 
-    int limit = sp->width;   // 0 = unlimited
-    int i = 0;
+// read_token for a scanset: reads bytes that are members of set.
+static size_t read_set(ScanCtx *ctx, const unsigned char *set, char *out, size_t limit) {
+    size_t i = 0;
 
-    int c = nextch();
-    if (c == EOF) return 0;
+    while (i < limit) {
+        if (ctx->pos == ctx->len && !refill(ctx)) break;
 
-    if (c != '"') {
-        // fallback: behave like %s (read until whitespace)
-        if (!isspace((unsigned char)c)) {
-            while (c != EOF && !isspace((unsigned char)c)) {
-                if (limit == 0 || i < limit) {
-                    if (!sp->suppress) out[i] = (char)c;
-                    i++;
-                } else {
-                    unreadch(c);
-                    break;
-                }
-                c = nextch();
-            }
-            if (c != EOF && isspace((unsigned char)c)) unreadch(c);
+        const unsigned char *p = ctx->buf + ctx->pos;
+        const unsigned char *end = ctx->buf + ctx->len;
+        if ((size_t)(end - p) > limit - i) end = p + (limit - i);
 
-            if (!sp->suppress) {
-                int term = (limit == 0) ? i : (i < limit ? i : limit);
-                out[term] = '\0';
-            }
-            return 1;
-        } else {
-            unreadch(c);
-            return 0;
-        }
+        const unsigned char *stop = find_notin(set, p, end);
+        size_t n = (size_t)(stop - p);
+        if (out) memcpy(out + i, p, n);
+        i += n;
+        ctx->pos += n;
+        if (stop < ctx->buf + ctx->len) break;   // hit a non-member or width
     }
+    return i;
+}
 
-    // inside quotes: read until closing quote
-    while ((c = nextch()) != EOF) {
-        if (c == '"') {
-            if (!sp->suppress) {
-                int term = (limit == 0) ? i : (i < limit ? i : limit);
-                out[term] = '\0';
-            }
-            return 1;
-        }
-
-        if (limit == 0 || i < limit) {
-            if (!sp->suppress) out[i] = (char)c;
-            i++;
-        } else {
-            // width reached: keep consuming until closing quote, don't store
-        }
+// Starts a view at the cursor. On a buffered source the view is recorded
+// so that refill keeps (and moves) its bytes until the next call on ctx.
+static int view_begin(ScanCtx *ctx, ScanView *v) {
+    if (ctx->transient) return 0;
+    v->ptr = (const char *)ctx->buf + ctx->pos;
+    v->len = 0;
+    if (ctx->src == SRC_MEM || ctx->src == SRC_MMAP) return 1;   // never refilled
+
+    if (ctx->nviews == ctx->views_cap) {
+        size_t cap = ctx->views_cap ? ctx->views_cap * 2 : 8;
+        ScanView **views = realloc(ctx->views, cap * sizeof *views);
+        if (!views) return 0;
+        ctx->views = views;
+        ctx->views_cap = cap;
     }
+    ctx->views[ctx->nviews++] = v;
+    return 1;
+}
 
-    // EOF before closing quote
-    if (!sp->suppress) {
-        int term = (limit == 0) ? i : (i < limit ? i : limit);
-        out[term] = '\0';
-    }
-    return 0;
+// Forgets the last view started (its conversion failed).
+static void view_drop(ScanCtx *ctx, ScanView *v) {
+    if (ctx->nviews > 0 && ctx->views[ctx->nviews - 1] == v) ctx->nviews--;
 }
 
+// A new call on ctx: views and marks from earlier calls no longer hold the buffer.
+static inline void ctx_begin(ScanCtx *ctx) {
+    ctx->nviews = 0;
+    ctx->hold = NO_HOLD;
+}
 
-// %b: reads a binary integer (base 2), similar to %x for hex
-static int scan_b(const Spec *sp, va_list *ap) {
-    skip_input_ws();
 
-    int limit = sp->width;
-    int used = 0;
+/* =============================
+   Integer kernels: read_digits / read_pow2_digits + range-checked stores
+   Runs of 8 digits (decimal, hex or binary) are checked and converted at
+   once with SWAR (SIMD-within-a-register) arithmetic on a 64-bit load.
+   ============================= */
 
-    int c = nextch();
-    if (c == EOF) return 0;
+#include <limits.h>
+
+static inline int is_digit(int c) {
+    return (unsigned)(c - '0') <= 9u;
+}
+
+static int hex_value(int c) {
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('a' <= c && c <= 'f') return 10 + (c - 'a');
+    if ('A' <= c && c <= 'F') return 10 + (c - 'A');
+    return -1;
+}
 
-    if (c != '0' && c != '1') { unreadch(c); return 0; }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define HAVE_SWAR_DIGITS 1
 
-    unsigned long long value = 0;
+// all 8 bytes of w are '0'..'9'
+static inline int is_eight_digits(uint64_t w) {
+    return (((w & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
 
-    while (c != EOF && (c == '0' || c == '1')) {
-        if (limit != 0 && used >= limit) { unreadch(c); break; }
-        value = value * 2ULL + (unsigned long long)(c - '0');
-        used++;
-        c = nextch();
+// value of 8 ASCII digits, first digit in the lowest byte
+static inline uint32_t parse_eight_digits(uint64_t w) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL;   // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL;   // 1 + (10000 << 32)
+    w -= 0x3030303030303030ULL;
+    w = (w * 10) + (w >> 8);                       // pairs of digits
+    w = (((w & mask) * mul1) + (((w >> 16) & mask) * mul2)) >> 32;
+    return (uint32_t)w;
+}
+
+// high bit of each byte set where lo <= byte <= hi (bytes of x below 0x80)
+static inline uint64_t bytes_in_range(uint64_t x, unsigned lo, unsigned hi) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    return (x + ones * (0x80 - lo)) & ~(x + ones * (0x7F - hi)) & 0x8080808080808080ULL;
+}
+
+// all 8 bytes of w are hex digits
+static inline int is_eight_hex(uint64_t w) {
+    const uint64_t high = 0x8080808080808080ULL;
+    uint64_t x = w & ~high;
+    uint64_t ok = bytes_in_range(x, '0', '9') | bytes_in_range(x | 0x2020202020202020ULL, 'a', 'f');
+    return (ok & ~w) == high;
+}
+
+// value of 8 hex digits, first digit in the lowest byte
+static inline uint32_t parse_eight_hex(uint64_t w) {
+    // nibble per byte: low 4 bits, +9 for letters (bit 6 set)
+    uint64_t n = (w & 0x0F0F0F0F0F0F0F0FULL) + 9 * ((w >> 6) & 0x0101010101010101ULL);
+    // merge neighbours, first one high: bytes -> 16-bit lanes -> 32 -> 64
+    n = ((n & 0x000F000F000F000FULL) << 4) | ((n >> 8) & 0x000F000F000F000FULL);
+    n = ((n & 0x000000FF000000FFULL) << 8) | ((n >> 16) & 0x000000FF000000FFULL);
+    n = ((n & 0x000000000000FFFFULL) << 16) | ((n >> 32) & 0x000000000000FFFFULL);
+    return (uint32_t)n;
+}
+
+// all 8 bytes of w are '0' or '1'
+static inline int is_eight_bin(uint64_t w) {
+    return (w & 0xFEFEFEFEFEFEFEFEULL) == 0x3030303030303030ULL;
+}
+
+// value of 8 binary digits, first digit in the lowest byte
+static inline unsigned parse_eight_bin(uint64_t w) {
+    // gathers bit 0 of byte i into bit 63 - i
+    return (unsigned)(((w & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56);
+}
+#endif
+
+static inline void acc_digit(unsigned long long *v, int d, int *ovf) {
+    if (__builtin_mul_overflow(*v, 10ULL, v) ||
+        __builtin_add_overflow(*v, (unsigned long long)d, v)) *ovf = 1;
+}
+
+// Consumes up to limit decimal digits, accumulating into *acc. *ovf is set
+// once the value no longer fits in 64 bits (the digits are still consumed).
+// Returns the number of digits read; the byte that stopped it stays unread.
+static size_t read_digits(ScanCtx *ctx, unsigned long long *acc, size_t limit, int *ovf) {
+    unsigned long long v = *acc;
+    size_t used = 0;
+
+    while (used < limit) {
+        if (ctx->pos == ctx->len && !refill(ctx)) break;
+
+        const unsigned char *p = ctx->buf + ctx->pos;
+        const unsigned char *end = ctx->buf + ctx->len;
+        if ((size_t)(end - p) > limit - used) end = p + (limit - used);
+
+        const unsigned char *q = p;
+#ifdef HAVE_SWAR_DIGITS
+        while (end - q >= 8) {
+            uint64_t w;
+            memcpy(&w, q, 8);
+            if (!is_eight_digits(w)) break;
+            if (__builtin_mul_overflow(v, 100000000ULL, &v) ||
+                __builtin_add_overflow(v, (unsigned long long)parse_eight_digits(w), &v)) *ovf = 1;
+            q += 8;
+        }
+#endif
+        while (q < end && is_digit(*q)) {
+            acc_digit(&v, *q - '0', ovf);
+            q++;
+        }
+
+        used += (size_t)(q - p);
+        ctx->pos += (size_t)(q - p);
+        if (q < ctx->buf + ctx->len) break;   // stopped on a non-digit or the width
     }
 
-    if (c != EOF && !(c == '0' || c == '1')) unreadch(c);
+    *acc = v;
+    return used;
+}
 
-    if (sp->suppress) {
-        return 1;   
+// %x (bits = 4) and %b (bits = 1)
+static inline int pow2_value(int c, int bits) {
+    if (bits == 4) return hex_value(c);
+    return (c == '0' || c == '1') ? c - '0' : -1;
+}
+
+static inline void acc_pow2(unsigned long long *v, int d, int bits, int *ovf) {
+    if (*v >> (64 - bits)) *ovf = 1;
+    *v = (*v << bits) | (unsigned)d;
+}
+
+// Like read_digits, for base 16 (bits = 4) or base 2 (bits = 1).
+static size_t read_pow2_digits(ScanCtx *ctx, unsigned long long *acc, size_t limit, int bits, int *ovf) {
+    unsigned long long v = *acc;
+    size_t used = 0;
+
+    while (used < limit) {
+        if (ctx->pos == ctx->len && !refill(ctx)) break;
+
+        const unsigned char *p = ctx->buf + ctx->pos;
+        const unsigned char *end = ctx->buf + ctx->len;
+        if ((size_t)(end - p) > limit - used) end = p + (limit - used);
+
+        const unsigned char *q = p;
+#ifdef HAVE_SWAR_DIGITS
+        while (end - q >= 8) {
+            uint64_t w;
+            memcpy(&w, q, 8);
+            if (bits == 4) {
+                if (!is_eight_hex(w)) break;
+                if (v >> 32) *ovf = 1;
+                v = (v << 32) | parse_eight_hex(w);
+            } else {
+                if (!is_eight_bin(w)) break;
+                if (v >> 56) *ovf = 1;
+                v = (v << 8) | parse_eight_bin(w);
+            }
+            q += 8;
+        }
+#endif
+        int d;
+        while (q < end && (d = pow2_value(*q, bits)) >= 0) {
+            acc_pow2(&v, d, bits, ovf);
+            q++;
+        }
+
+        used += (size_t)(q - p);
+        ctx->pos += (size_t)(q - p);
+        if (q < ctx->buf + ctx->len) break;   // stopped on a non-digit or the width
     }
 
-    // store like %x using len
-    if (sp->len == LEN_NONE) {
-        unsigned int *out = va_arg(*ap, unsigned int*);
-        *out = (unsigned int)value;
-    } else if (sp->len == LEN_L) {
-        unsigned long *out = va_arg(*ap, unsigned long*);
-        *out = (unsigned long)value;
-    } else if (sp->len == LEN_LL) {
-        unsigned long long *out = va_arg(*ap, unsigned long long*);
-        *out = (unsigned long long)value;
+    *acc = v;
+    return used;
+}
+
+// Stores v into the unsigned type selected by len, checking its range.
+// Returns 0 if the value is out of range under MY_SCANF_OVERFLOW_FAIL.
+// A NULL dst only checks the range (suppressed conversions).
+static int store_unsigned(ScanCtx *ctx, void *dst, Length len, unsigned long long v, int ovf) {
+    unsigned long long hi;
+    switch (len) {
+        case LEN_HH:   hi = UCHAR_MAX;  break;
+        case LEN_H:    hi = USHRT_MAX;  break;
+        case LEN_NONE: hi = UINT_MAX;   break;
+        case LEN_L:    hi = ULONG_MAX;  break;
+        case LEN_LL:   hi = ULLONG_MAX; break;
+        default:       return 0;
+    }
+
+    if (ovf || v > hi) {
+        errno = ERANGE;
+        if (ctx->overflow_policy == MY_SCANF_OVERFLOW_FAIL) return 0;
+        v = hi;
+    }
+    if (!dst) return 1;
+
+    switch (len) {
+        case LEN_HH:   *(unsigned char*)dst = (unsigned char)v;   break;
+        case LEN_H:    *(unsigned short*)dst = (unsigned short)v; break;
+        case LEN_NONE: *(unsigned int*)dst = (unsigned int)v;     break;
+        case LEN_L:    *(unsigned long*)dst = (unsigned long)v;   break;
+        default:       *(unsigned long long*)dst = v;             break;
+    }
+    return 1;
+}
+
+// Stores -mag / +mag into the integer type selected by len, checking its range.
+// Returns 0 if the value is out of range under MY_SCANF_OVERFLOW_FAIL.
+static int store_signed(ScanCtx *ctx, void *dst, Length len, int neg, unsigned long long mag, int ovf) {
+    long long lo, hi;
+    switch (len) {
+        case LEN_HH:   lo = SCHAR_MIN; hi = SCHAR_MAX; break;
+        case LEN_H:    lo = SHRT_MIN;  hi = SHRT_MAX;  break;
+        case LEN_NONE: lo = INT_MIN;   hi = INT_MAX;   break;
+        case LEN_L:    lo = LONG_MIN;  hi = LONG_MAX;  break;
+        case LEN_LL:   lo = LLONG_MIN; hi = LLONG_MAX; break;
+        default:       return 0;
+    }
+
+    unsigned long long max_mag = (unsigned long long)hi + (neg ? 1u : 0u);
+    long long v;
+    if (ovf || mag > max_mag) {
+        errno = ERANGE;
+        if (ctx->overflow_policy == MY_SCANF_OVERFLOW_FAIL) return 0;
+        v = neg ? lo : hi;
+    } else if (neg) {
+        v = (mag == 0) ? 0 : -(long long)(mag - 1) - 1;
+    } else {
+        v = (long long)mag;
+    }
+    if (!dst) return 1;
+
+    switch (len) {
+        case LEN_HH:   *(signed char*)dst = (signed char)v; break;
+        case LEN_H:    *(short*)dst = (short)v;             break;
+        case LEN_NONE: *(int*)dst = (int)v;                 break;
+        case LEN_L:    *(long*)dst = (long)v;               break;
+        default:       *(long long*)dst = v;                break;
+    }
+    return 1;
+}
+
+
+/* =============================
+   Float kernels: decimal/hex digits -> float/double bits
+   Clinger's fast path when the value is exact in floating point,
+   otherwise Eisel–Lemire with a 128-bit table of powers of five.
+   Inputs with more than 19 significant digits that Eisel–Lemire can't
+   settle on its own go to the (correctly rounded) libc strtod/strtof.
+   ============================= */
+
+#include <float.h>   // for FLT_EVAL_METHOD
+#include <math.h>    // for INFINITY, NAN
+
+// 128-bit approximations of 5^q for q in [-342, 308], high word first
+#define POW5_MIN_Q (-342)
+static const uint64_t pow5_128[] = {
+    0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL,
+    0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+    0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL,
+    0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+    0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL,
+    0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+    0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL,
+    0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+    0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL,
+    0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+    0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL,
+    0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+    0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL,
+    0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+    0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL,
+    0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+    0x84a57695fe98746dULL, 0x014bb630f7604b57ULL,
+    0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+    0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL,
+    0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+    0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL,
+    0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+    0xfd00b897478238d0ULL, 0x8920b098955522b4ULL,
+    0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+    0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL,
+    0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+    0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL,
+    0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+    0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL,
+    0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+    0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL,
+    0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+    0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL,
+    0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+    0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL,
+    0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+    0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL,
+    0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+    0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL,
+    0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+    0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL,
+    0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+    0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL,
+    0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+    0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL,
+    0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+    0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL,
+    0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+    0xa37fce126597973cULL, 0xe50ff107bab528a0ULL,
+    0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+    0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL,
+    0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+    0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL,
+    0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+    0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL,
+    0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+    0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL,
+    0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+    0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL,
+    0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+    0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL,
+    0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+    0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL,
+    0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+    0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL,
+    0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+    0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL,
+    0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+    0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL,
+    0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+    0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL,
+    0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+    0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL,
+    0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+    0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL,
+    0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+    0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL,
+    0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+    0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL,
+    0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+    0xc987434744ac874eULL, 0xa327ffb266b56220ULL,
+    0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+    0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL,
+    0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+    0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL,
+    0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+    0xc0314325637a1939ULL, 0xfa911155fefb5308ULL,
+    0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+    0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL,
+    0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+    0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL,
+    0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+    0xb749faed14125d36ULL, 0xcef980ec671f667bULL,
+    0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+    0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL,
+    0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+    0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL,
+    0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+    0xaecc49914078536dULL, 0x58fae9f773886e18ULL,
+    0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+    0x888f99797a5e012dULL, 0x6d8406c952429603ULL,
+    0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+    0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL,
+    0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+    0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL,
+    0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+    0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL,
+    0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+    0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL,
+    0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+    0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL,
+    0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+    0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL,
+    0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+    0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL,
+    0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+    0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL,
+    0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+    0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL,
+    0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+    0xb913179899f68584ULL, 0x28e2557b59846e3fULL,
+    0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+    0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL,
+    0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+    0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL,
+    0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+    0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL,
+    0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+    0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL,
+    0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+    0xd77485cb25823ac7ULL, 0x7d633293366b828bULL,
+    0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+    0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL,
+    0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+    0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL,
+    0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+    0xcd795be870516656ULL, 0x67902e276c921f8bULL,
+    0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+    0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL,
+    0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+    0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL,
+    0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+    0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL,
+    0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+    0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL,
+    0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+    0xef340a98172aace4ULL, 0x86fb897116c87c34ULL,
+    0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+    0xbae0a846d2195712ULL, 0x8974836059cca109ULL,
+    0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+    0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL,
+    0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+    0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL,
+    0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+    0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL,
+    0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+    0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL,
+    0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+    0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL,
+    0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+    0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL,
+    0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+    0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL,
+    0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+    0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL,
+    0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+    0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL,
+    0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+    0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL,
+    0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+    0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL,
+    0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+    0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL,
+    0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+    0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL,
+    0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+    0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL,
+    0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+    0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL,
+    0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+    0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL,
+    0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+    0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL,
+    0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+    0x8c974f7383725573ULL, 0x1e414218c73a13fbULL,
+    0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+    0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL,
+    0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+    0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL,
+    0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+    0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL,
+    0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+    0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL,
+    0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+    0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL,
+    0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+    0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL,
+    0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+    0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL,
+    0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+    0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL,
+    0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+    0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL,
+    0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+    0xbe89523386091465ULL, 0xf6bbb397f1135823ULL,
+    0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+    0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL,
+    0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+    0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL,
+    0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+    0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL,
+    0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+    0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL,
+    0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+    0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL,
+    0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+    0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL,
+    0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+    0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL,
+    0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+    0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL,
+    0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+    0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL,
+    0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+    0x811ccc668829b887ULL, 0x0806357d5a3f525fULL,
+    0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+    0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL,
+    0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+    0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL,
+    0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+    0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL,
+    0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+    0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL,
+    0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+    0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL,
+    0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+    0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL,
+    0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+    0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL,
+    0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+    0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL,
+    0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+    0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL,
+    0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+    0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL,
+    0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+    0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL,
+    0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+    0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL,
+    0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+    0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL,
+    0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+    0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL,
+    0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+    0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL,
+    0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+    0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL,
+    0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+    0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL,
+    0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+    0xc24452da229b021bULL, 0xfbe85badce996168ULL,
+    0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+    0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL,
+    0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+    0xed246723473e3813ULL, 0x290123e9aab23b68ULL,
+    0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+    0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL,
+    0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+    0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL,
+    0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+    0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL,
+    0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+    0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL,
+    0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+    0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL,
+    0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+    0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL,
+    0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL,
+    0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL,
+    0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL,
+    0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL,
+    0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL,
+    0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL,
+    0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL,
+    0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL,
+    0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL,
+    0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL,
+    0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL,
+    0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL,
+    0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL,
+    0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL,
+    0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL,
+    0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL,
+    0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL,
+    0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL,
+    0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL,
+    0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL,
+    0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL,
+    0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL,
+    0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL,
+    0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL,
+    0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL,
+    0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL,
+    0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL,
+    0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL,
+    0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL,
+    0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL,
+    0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL,
+    0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL,
+    0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL,
+    0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL,
+    0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL,
+    0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL,
+    0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL,
+    0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL,
+    0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL,
+    0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL,
+    0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL,
+    0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL,
+    0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL,
+    0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL,
+    0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL,
+    0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL,
+    0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL,
+    0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL,
+    0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL,
+    0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL,
+    0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL,
+    0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL,
+    0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL,
+    0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL,
+    0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL,
+    0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL,
+    0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL,
+    0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL,
+    0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL,
+    0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL,
+    0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL,
+    0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL,
+    0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL,
+    0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL,
+    0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL,
+    0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+    0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL,
+    0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+    0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL,
+    0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+    0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL,
+    0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+    0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL,
+    0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+    0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL,
+    0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+    0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL,
+    0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+    0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL,
+    0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+    0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL,
+    0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+    0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL,
+    0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+    0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL,
+    0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+    0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL,
+    0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+    0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL,
+    0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+    0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL,
+    0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+    0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL,
+    0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+    0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL,
+    0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+    0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL,
+    0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+    0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL,
+    0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+    0x924d692ca61be758ULL, 0x593c2626705f9c56ULL,
+    0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+    0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL,
+    0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+    0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL,
+    0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+    0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL,
+    0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+    0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL,
+    0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+    0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL,
+    0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+    0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL,
+    0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+    0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL,
+    0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+    0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL,
+    0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+    0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL,
+    0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+    0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL,
+    0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+    0x9ae757596946075fULL, 0x3375788de9b06958ULL,
+    0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+    0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL,
+    0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+    0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL,
+    0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+    0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL,
+    0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+    0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL,
+    0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+    0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL,
+    0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+    0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL,
+    0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+    0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL,
+    0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+    0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL,
+    0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+    0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL,
+    0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+    0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL,
+    0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+    0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL,
+    0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+    0x802221226be55a64ULL, 0xc2494954da2c9789ULL,
+    0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+    0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL,
+    0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+    0x9c69a97284b578d7ULL, 0xff2a760414536efbULL,
+    0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+    0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL,
+    0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+    0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL,
+    0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+    0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL,
+    0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+    0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL,
+    0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+    0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL,
+    0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+    0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL,
+    0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+    0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL,
+    0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+    0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL,
+    0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+    0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL,
+    0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+    0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL,
+    0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+    0xa59bc234db398c25ULL, 0x43fab9837e699095ULL,
+    0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+    0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL,
+    0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+    0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL,
+    0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+    0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL,
+    0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+    0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL,
+    0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+    0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL,
+    0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+    0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL,
+    0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+    0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL,
+    0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+    0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL,
+    0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+    0x8fa475791a569d10ULL, 0xf96e017d694487bcULL,
+    0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+    0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL,
+    0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+    0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL,
+    0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+    0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL,
+    0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+    0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL,
+    0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+    0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL,
+    0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+    0x82a45b450226b39cULL, 0xecc0024661173473ULL,
+    0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+    0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL,
+    0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+    0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL,
+    0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+    0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL,
+    0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+    0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL,
+    0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+    0x98165af37b2153deULL, 0xc3727a337a8b704aULL,
+    0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+    0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL,
+    0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+    0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL,
+    0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+    0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL,
+    0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+    0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL,
+    0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+    0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL,
+    0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+    0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL,
+    0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+    0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL,
+    0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+    0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL,
+    0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+    0x83ea2b892091e44dULL, 0x934aed0aab460432ULL,
+    0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+    0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL,
+    0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+    0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL,
+    0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+    0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL,
+    0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+    0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL,
+    0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+    0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL,
+    0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+    0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL,
+    0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+    0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL,
+    0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+    0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL,
+    0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+    0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL,
+    0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+    0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL,
+    0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+    0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL,
+    0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+    0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL,
+    0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+    0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL,
+    0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+    0x8533285c936b35deULL, 0xd53a88958f87275fULL,
+    0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+    0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL,
+    0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+    0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL,
+    0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+    0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL,
+    0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+    0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL,
+    0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+    0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL,
+    0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+    0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL,
+    0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+    0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL,
+    0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+    0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL,
+    0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+    0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL,
+    0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+    0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL,
+    0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+    0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL,
+    0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+    0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL,
+    0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+    0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL,
+    0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+    0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL,
+    0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+    0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL,
+    0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+    0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL,
+    0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+    0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL,
+    0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+    0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL,
+    0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+    0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL,
+    0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+    0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL,
+    0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+    0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL,
+    0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+    0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL,
+    0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+    0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL,
+    0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+    0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL,
+    0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+    0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL,
+};
+
+typedef struct {
+    int mbits;          // explicit mantissa bits
+    int min_exp;        // exponent of the smallest normal, minus one (-1023 / -127)
+    int inf_power;      // biased exponent of infinity
+    int min_q, max_q;   // below: always 0, above: always infinity
+    int min_even_q;     // range of q where a product can be an exact halfway case
+    int max_even_q;
+} FloatFmt;
+
+static const FloatFmt FMT_DOUBLE = { 52, -1023, 0x7FF, -342, 308, -4, 23 };
+static const FloatFmt FMT_FLOAT  = { 23, -127,  0xFF,  -64,  38,  -17, 10 };
+
+static inline void mul_64x64(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (uint64_t)(r >> 64);
+    *lo = (uint64_t)r;
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    *lo = (mid << 32) | (uint32_t)ll;
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+// Eisel–Lemire: w * 10^q (w exact) -> IEEE bits without the sign
+static uint64_t lemire(const FloatFmt *f, int64_t q, uint64_t w) {
+    if (w == 0 || q < f->min_q) return 0;
+    if (q > f->max_q) return (uint64_t)f->inf_power << f->mbits;
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    // w * 5^q, keeping mbits+3 good bits at the top of hi
+    int idx = 2 * (int)(q - POW5_MIN_Q);
+    uint64_t hi, lo;
+    mul_64x64(w, pow5_128[idx], &hi, &lo);
+    uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> (f->mbits + 3);
+    if ((hi & precision_mask) == precision_mask) {
+        uint64_t hi2, lo2;
+        mul_64x64(w, pow5_128[idx + 1], &hi2, &lo2);
+        lo += hi2;
+        if (hi2 > lo) hi++;
+    }
+
+    int upperbit = (int)(hi >> 63);
+    int shift = upperbit + 64 - f->mbits - 3;
+    uint64_t m = hi >> shift;
+    // floor(log2(10^q)) + 63, minus normalisation, biased
+    int32_t power2 = (int32_t)((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz - f->min_exp;
+
+    if (power2 <= 0) {
+        // subnormal (or zero)
+        if (-power2 + 1 >= 64) return 0;
+        m >>= -power2 + 1;
+        m += (m & 1);
+        m >>= 1;
+        // rounding may carry into the smallest normal; the bit pattern is the same
+        return m;
+    }
+
+    // exact halfway case: round to even instead of up
+    if (lo <= 1 && q >= f->min_even_q && q <= f->max_even_q && (m & 3) == 1 &&
+        (m << shift) == hi) {
+        m &= ~1ULL;
+    }
+    m += (m & 1);
+    m >>= 1;
+    if (m >= (2ULL << f->mbits)) {
+        m = 1ULL << f->mbits;
+        power2++;
+    }
+    m &= ~(1ULL << f->mbits);
+    if (power2 >= f->inf_power) return (uint64_t)f->inf_power << f->mbits;
+    return ((uint64_t)power2 << f->mbits) | m;
+}
+
+// m * 2^e2, rounded to nearest-even (bit 0 of m may be a sticky bit) -> IEEE bits
+static uint64_t round_binary(const FloatFmt *f, uint64_t m, int64_t e2) {
+    if (m == 0) return 0;
+    int lz = __builtin_clzll(m);
+    m <<= lz;
+    e2 -= lz;
+
+    int64_t be = e2 + 63 - f->min_exp;     // biased exponent of the leading bit
+    int64_t drop = 63 - f->mbits;
+    if (be <= 0) {
+        drop += 1 - be;                     // subnormal: fewer bits survive
+        be = 0;
+    }
+    if (be >= f->inf_power) return (uint64_t)f->inf_power << f->mbits;
+
+    uint64_t keep;
+    if (drop > 64) {
+        keep = 0;
+    } else if (drop == 64) {
+        keep = (m > (1ULL << 63)) ? 1 : 0;  // the top bit is set, so this is >= half
+    } else {
+        uint64_t rem = m & ((1ULL << drop) - 1);
+        uint64_t half = 1ULL << (drop - 1);
+        keep = m >> drop;
+        if (rem > half || (rem == half && (keep & 1))) keep++;
+    }
+
+    if (be == 0) return keep;               // carry into the normal range works out
+    if (keep >> (f->mbits + 1)) {
+        keep >>= 1;
+        be++;
+        if (be >= f->inf_power) return (uint64_t)f->inf_power << f->mbits;
+    }
+    return ((uint64_t)be << f->mbits) | (keep & ((1ULL << f->mbits) - 1));
+}
+
+#define FLT_MAX_DIGITS 768   // significant digits kept for the slow path (enough for any double)
+
+typedef enum { FD_NUM, FD_HEX, FD_INF, FD_NAN } FloatKind;
+
+// The scanned number, before conversion to a binary format.
+typedef struct {
+    FloatKind kind;
+    uint64_t w;         // FD_NUM: first 19 significant digits; FD_HEX: first 16 hex digits
+    int64_t exp;        // FD_NUM: value = 0.digits * 10^exp; FD_HEX: value = w * 2^exp
+    int nd;             // significant digits seen
+    int truncated;      // a nonzero digit didn't fit in w
+    int sticky;         // a nonzero digit didn't fit in digits[]
+    int nstored;
+    char digits[FLT_MAX_DIGITS];
+} FloatDec;
+
+static void fd_init(FloatDec *d) {
+    d->kind = FD_NUM;
+    d->w = 0;
+    d->exp = 0;
+    d->nd = 0;
+    d->truncated = 0;
+    d->sticky = 0;
+    d->nstored = 0;
+}
+
+static void fd_add_digit(FloatDec *d, int c, int frac) {
+    if (d->nd == 0 && c == '0') {
+        if (frac) d->exp--;     // leading zeros only move the decimal point
+        return;
+    }
+    if (!frac) d->exp++;
+    if (d->nd < 19) d->w = d->w * 10 + (uint64_t)(c - '0');
+    else if (c != '0') d->truncated = 1;
+    if (d->nstored < FLT_MAX_DIGITS) d->digits[d->nstored++] = (char)c;
+    else if (c != '0') d->sticky = 1;
+    d->nd++;
+}
+
+static void fd_add_hex(FloatDec *d, int v, int frac) {
+    if (d->nd == 0 && v == 0) {
+        if (frac) d->exp -= 4;
+        return;
+    }
+    if (d->nd < 16) {
+        d->w = (d->w << 4) | (uint64_t)v;
+        if (frac) d->exp -= 4;
     } else {
+        if (!frac) d->exp += 4;
+        if (v) d->truncated = 1;
+    }
+    d->nd++;
+}
+
+// Text for the libc fallback: "-0.<digits>e<exp>" or "-0x<w>p<exp>"
+static void fd_text(const FloatDec *d, int neg, char *buf, size_t cap) {
+    char *p = buf;
+    if (neg) *p++ = '-';
+    if (d->kind == FD_HEX) {
+        // a trailing 1 digit stands in for the dropped nonzero digits
+        if (d->truncated) snprintf(p, cap - 1, "0x%llx1p%lld", (unsigned long long)d->w, (long long)d->exp - 4);
+        else snprintf(p, cap - 1, "0x%llxp%lld", (unsigned long long)d->w, (long long)d->exp);
+        return;
+    }
+    *p++ = '0';
+    *p++ = '.';
+    memcpy(p, d->digits, (size_t)d->nstored);
+    p += d->nstored;
+    if (d->sticky) *p++ = '1';
+    snprintf(p, cap - (size_t)(p - buf), "e%lld", (long long)d->exp);
+}
+
+// Converts to float (f == &FMT_FLOAT) or double bits; 0 means "use the slow path".
+static int fd_to_bits(const FloatDec *d, const FloatFmt *f, uint64_t *bits) {
+    if (d->kind == FD_HEX) {
+        *bits = round_binary(f, d->w | (uint64_t)d->truncated, d->exp);
+        return 1;
+    }
+    if (d->nd == 0) {
+        *bits = 0;
+        return 1;
+    }
+
+    int64_t q = d->exp - (d->nd < 19 ? d->nd : 19);
+    *bits = lemire(f, q, d->w);
+    if (!d->truncated) return 1;
+
+    // w and w+1 bracket the real value; if they agree, so does the value
+    return lemire(f, q, d->w + 1) == *bits;
+}
+
+static const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static double fd_to_double(const FloatDec *d, int neg) {
+    if (d->kind == FD_INF) return neg ? -INFINITY : INFINITY;
+    if (d->kind == FD_NAN) return neg ? -NAN : NAN;
+
+    double v;
+    int64_t q = d->exp - d->nd;
+#if FLT_EVAL_METHOD == 0
+    // Clinger: w and 10^|q| are exact doubles, so one IEEE operation rounds correctly
+    if (d->kind == FD_NUM && d->nd <= 19 && d->w <= (1ULL << 53) && q >= -22 && q <= 22) {
+        v = (double)d->w;
+        v = (q < 0) ? v / exact_pow10[-q] : v * exact_pow10[q];
+        return neg ? -v : v;
+    }
+#endif
+    uint64_t bits;
+    if (fd_to_bits(d, &FMT_DOUBLE, &bits)) {
+        memcpy(&v, &bits, sizeof v);
+    } else {
+        char buf[FLT_MAX_DIGITS + 48];
+        fd_text(d, 0, buf, sizeof buf);
+        v = strtod(buf, NULL);
+    }
+    if (isinf(v)) errno = ERANGE;
+    return neg ? -v : v;
+}
+
+static float fd_to_float(const FloatDec *d, int neg) {
+    if (d->kind == FD_INF) return neg ? -INFINITY : INFINITY;
+    if (d->kind == FD_NAN) return neg ? -NAN : NAN;
+
+    float v;
+    int64_t q = d->exp - d->nd;
+#if FLT_EVAL_METHOD == 0
+    if (d->kind == FD_NUM && d->nd <= 19 && d->w <= (1ULL << 24) && q >= -10 && q <= 10) {
+        v = (float)d->w;
+        v = (q < 0) ? v / (float)exact_pow10[-q] : v * (float)exact_pow10[q];
+        return neg ? -v : v;
+    }
+#endif
+    uint64_t bits;
+    if (fd_to_bits(d, &FMT_FLOAT, &bits)) {
+        uint32_t b32 = (uint32_t)bits;
+        memcpy(&v, &b32, sizeof v);
+    } else {
+        char buf[FLT_MAX_DIGITS + 48];
+        fd_text(d, 0, buf, sizeof buf);
+        v = strtof(buf, NULL);
+    }
+    if (isinf(v)) errno = ERANGE;
+    return neg ? -v : v;
+}
+
+static long double fd_to_long_double(const FloatDec *d, int neg) {
+    if (d->kind == FD_INF) return neg ? -INFINITY : INFINITY;
+    if (d->kind == FD_NAN) return neg ? -NAN : NAN;
+    if (d->kind == FD_NUM && d->nd == 0) return neg ? -0.0L : 0.0L;
+
+    char buf[FLT_MAX_DIGITS + 48];
+    fd_text(d, neg, buf, sizeof buf);
+    return strtold(buf, NULL);
+}
+
+
+/* =============================
+   Conversions: scan_c scan_s scan_d scan_x scan_f
+   Each takes the resolved Spec and the destination pointer
+   (NULL when the conversion is suppressed).
+   ============================= */
+
+// Output of a string conversion (%s, %q, %r): the caller's buffer, the
+// context's arena for %m (the char* is stored in dst on success), or
+// nowhere when suppressed.
+typedef struct {
+    char *buf;      // NULL: discard
+    Arena *arena;   // NULL: buf is the caller's and is assumed big enough
+    size_t len;
+} StrOut;
+
+static int so_open(StrOut *o, ScanCtx *ctx, const Spec *sp, void *dst) {
+    o->buf = NULL;
+    o->arena = NULL;
+    o->len = 0;
+    if (!dst) return 1;
+    if (!sp->alloc) {
+        o->buf = (char*)dst;
+        return 1;
+    }
+    o->arena = ctx->arena;
+    if (!o->arena || !arena_reserve(o->arena, 0, 64)) return 0;
+    o->buf = arena_open(o->arena);
+    return 1;
+}
+
+// room for n more bytes plus the terminator
+static inline int so_room(StrOut *o, size_t n) {
+    if (!o->arena || arena_room(o->arena) >= o->len + n + 1) return 1;
+    if (!arena_reserve(o->arena, o->len, 2 * (o->len + n + 1))) return 0;
+    o->buf = arena_open(o->arena);
+    return 1;
+}
+
+static inline int so_putc(StrOut *o, int c) {
+    if (o->buf) {
+        if (!so_room(o, 1)) return 0;
+        o->buf[o->len] = (char)c;
+    }
+    o->len++;
+    return 1;
+}
+
+// Reads a token like read_token into o, or a run of set members like
+// read_set when set is not NULL; returns the number of bytes read.
+static size_t so_token(StrOut *o, ScanCtx *ctx, size_t limit, const unsigned char *set) {
+    if (!o->arena) {
+        o->len = set ? read_set(ctx, set, o->buf, limit) : read_token(ctx, o->buf, limit);
+        return o->len;
+    }
+    while (o->len < limit) {
+        if (!so_room(o, 64)) break;
+        size_t want = arena_room(o->arena) - o->len - 1;
+        if (want > limit - o->len) want = limit - o->len;
+        size_t n = set ? read_set(ctx, set, o->buf + o->len, want)
+                       : read_token(ctx, o->buf + o->len, want);
+        o->len += n;
+        if (n < want) break;
+    }
+    return o->len;
+}
+
+static inline int so_write(StrOut *o, const unsigned char *p, size_t n) {
+    if (o->buf) {
+        if (!so_room(o, n)) return 0;
+        memcpy(o->buf + o->len, p, n);
+    }
+    o->len += n;
+    return 1;
+}
+
+// Consumes the rest of the line and its '\n', keeping the first limit
+// bytes in o. Each buffer's worth is searched with memchr and copied in
+// one block, and refill drops what has been consumed, so a line of any
+// length costs one pass. *n gets the line length, *last its final byte
+// (EOF for an empty line). Returns 1, 0 if the input was already at its
+// end, or -1 if o ran out of memory.
+static int so_line(StrOut *o, ScanCtx *ctx, size_t limit, size_t *n, int *last) {
+    *n = 0;
+    *last = EOF;
+    if (ctx->pos == ctx->len && !refill(ctx)) return 0;
+
+    while (ctx->pos < ctx->len || refill(ctx)) {
+        const unsigned char *p = ctx->buf + ctx->pos;
+        size_t avail = ctx->len - ctx->pos;
+        const unsigned char *nl = memchr(p, '\n', avail);
+        size_t run = nl ? (size_t)(nl - p) : avail;
+
+        size_t keep = limit - o->len;
+        if (keep > run) keep = run;
+        if (keep > 0 && !so_write(o, p, keep)) return -1;
+        if (run > 0) *last = p[run - 1];
+        *n += run;
+        ctx->pos += run;
+        if (nl) {
+            ctx->pos++;
+            break;
+        }
+    }
+    return 1;
+}
+
+// Terminates the string; a %m string is kept in the arena and handed to dst.
+static void so_finish(StrOut *o, void *dst) {
+    if (!o->buf) return;
+    o->buf[o->len] = '\0';
+    if (o->arena) {
+        arena_commit(o->arena, o->len + 1);
+        *(char**)dst = o->buf;
+    }
+}
+
+
+// %c: reads 1 character (or width characters); does not skip whitespace; not null-terminated
+static int scan_c(ScanCtx *ctx, const Spec *sp, void *dst) {
+    int n = (sp->width == 0) ? 1 : sp->width;
+
+    char *out = (char*)dst;
+
+    for (int i = 0; i < n; i++) {
+        int c = nextch(ctx);
+        if (c == EOF) return 0;
+        if (!sp->suppress) out[i] = (char)c;
+    }
+
+    return 1;
+}
+
+
+static int scan_s(ScanCtx *ctx, const Spec *sp, void *dst) {
+    // %s skips leading whitespace
+    skip_input_ws(ctx);
+
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;   // 0 means “no limit”
+    StrOut o;
+    if (!so_open(&o, ctx, sp, dst)) return 0;
+
+    // reads until whitespace, EOF or width; nothing read means %s fails
+    if (so_token(&o, ctx, limit, NULL) == 0) return 0;
+
+    // null-terminate; caller must provide at least (min(tokenlen,width)+1) space
+    so_finish(&o, dst);
+
+    return 1;
+}
+
+
+// %[set]: like %s, but reads members of the set and does not skip whitespace
+static int scan_set(ScanCtx *ctx, const Spec *sp, void *dst) {
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;
+    StrOut o;
+    if (!so_open(&o, ctx, sp, dst)) return 0;
+
+    if (so_token(&o, ctx, limit, sp->set) == 0) return 0;
+
+    so_finish(&o, dst);
+    return 1;
+}
+
+
+static int scan_d(ScanCtx *ctx, const Spec *sp, void *dst) {
+    // %d skips leading whitespace
+    skip_input_ws(ctx);
+
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;   // width counts digits only
+
+    int c = nextch(ctx);
+    if (c == EOF) return 0;
+
+    int neg = 0;
+
+    // optional sign
+    if (c == '+' || c == '-') {
+        neg = (c == '-');
+        c = nextch(ctx);
+        if (c == EOF) return 0;
+    }
+
+    // must have at least one digit
+    if (!is_digit(c)) {
+        unreadch(ctx, c);
+        return 0;
+    }
+    unreadch(ctx, c);
+
+    // %*d: when overflow can't fail, only the extent of the digit run matters
+    if (sp->suppress && ctx->overflow_policy != MY_SCANF_OVERFLOW_FAIL) {
+        read_set(ctx, digit_set, NULL, limit);
+        return 1;
+    }
+
+    unsigned long long mag = 0;
+    int ovf = 0;
+    read_digits(ctx, &mag, limit, &ovf);
+
+    return store_signed(ctx, dst, sp->len, neg, mag, ovf);
+}
+
+
+static int scan_x(ScanCtx *ctx, const Spec *sp, void *dst) {
+    // %x skips leading whitespace
+    skip_input_ws(ctx);
+
+    int limit = sp->width;  // 0 = no limit
+    int used = 0;
+
+    // "0x" may have to be given back whole
+    ScanMark start = ctx_mark(ctx);
+
+    int c = nextch(ctx);
+    if (c == EOF) {
+        ctx_release(ctx, start);
+        return 0;
+    }
+    used++;
+
+    // Optional 0x / 0X prefix
+    if (c == '0') {
+        if (limit == 0 || used < limit) {
+            int c2 = nextch(ctx);
+            if (c2 == EOF) {
+                ctx_release(ctx, start);
+                return 0;
+            }
+            used++;    
+
+            if (c2 == 'x' || c2 == 'X') {
+                // we consumed "0x"; now read the first digit (if width allows)
+                if (limit != 0 && used >= limit) {
+                    // width ended exactly after 'x' → no digits allowed → fail
+                    ctx_rewind(ctx, start);
+                    ctx_release(ctx, start);
+                    return 0;
+                }
+
+                c = nextch(ctx);
+                if (c == EOF) {
+                    ctx_release(ctx, start);
+                    return 0;
+                }
+                used++; 
+            } else {
+                unreadch(ctx, c2);
+                used--; 
+            }
+        }
+    }
+    ctx_release(ctx, start);
+
+    // Must have at least one hex digit
+    int hv = hex_value(c);
+    if (hv < 0) {
+        unreadch(ctx, c);
+        used--; 
         return 0;
     }
-    return 1;
+
+    // the rest of the digits, up to the width; the byte after them stays unread
+    size_t rest = (limit == 0) ? SIZE_MAX : (size_t)(limit - used);
+    if (sp->suppress && ctx->overflow_policy != MY_SCANF_OVERFLOW_FAIL) {
+        read_set(ctx, hex_set, NULL, rest);
+        return 1;
+    }
+    unsigned long long value = (unsigned long long)hv;
+    int ovf = 0;
+    read_pow2_digits(ctx, &value, rest, 4, &ovf);
+
+    return store_unsigned(ctx, dst, sp->len, value, ovf);
+}
+
+// Field: a width-limited view of the input for conversions that need to
+// look ahead and go back (%f). The caller holds a mark at the start of
+// the field, so any point inside it can be rewound to.
+typedef struct {
+    ScanCtx *ctx;
+    int limit;      // 0 = no limit
+    int used;
+} Field;
+
+typedef struct {
+    uint64_t at;    // stream offset
+    int used;
+} FieldMark;
+
+static int field_getc(Field *f) {
+    if (f->limit != 0 && f->used >= f->limit) return EOF;
+    f->used++;
+    return nextch(f->ctx);
+}
+
+static void field_ungetc(Field *f, int c) {
+    if (c != EOF) {
+        unreadch(f->ctx, c);
+        f->used--;
+    }
+}
+
+// The point just before c, the character last read (EOF: the cursor).
+static FieldMark field_mark(const Field *f, int c) {
+    int back = (c != EOF);
+    FieldMark m = { f->ctx->base + f->ctx->pos - (uint64_t)back, f->used - back };
+    return m;
+}
+
+static void field_rewind(Field *f, FieldMark m) {
+    ScanMark sm = { m.at, NO_HOLD };
+    ctx_rewind(f->ctx, sm);
+    f->used = m.used;
+}
+
+// Reads the rest of word case-insensitively; on a mismatch gives back everything it read.
+static int field_match(Field *f, const char *word) {
+    FieldMark m = field_mark(f, EOF);
+    for (int n = 0; word[n]; n++) {
+        int c = field_getc(f);
+        if (c == EOF || tolower(c) != word[n]) {
+            field_rewind(f, m);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Consumes the run of decimal (hex: hex) digits that starts with c, the
+// character last read, adding them to d; returns the character after the
+// run. With d NULL (%*f) the digits are only skipped, in blocks.
+static int field_digits(Field *f, int c, FloatDec *d, int hex, int frac) {
+    int v;
+    if (!d) {
+        if (hex ? hex_value(c) < 0 : !is_digit(c)) return c;
+        size_t room = (f->limit == 0) ? SIZE_MAX : (size_t)(f->limit - f->used);
+        f->used += (int)read_set(f->ctx, hex ? hex_set : digit_set, NULL, room);
+        return field_getc(f);
+    }
+    if (hex) {
+        while ((v = hex_value(c)) >= 0) {
+            fd_add_hex(d, v, frac);
+            c = field_getc(f);
+        }
+    } else {
+        while (is_digit(c)) {
+            fd_add_digit(d, c, frac);
+            c = field_getc(f);
+        }
+    }
+    return c;
+}
+
+// "inf", "infinity", "nan", "nan(chars)"; c is the first letter.
+// d may be NULL (%*f).
+static int scan_infnan(Field *f, int c, FloatDec *d) {
+    if (tolower(c) == 'i') {
+        if (!field_match(f, "nf")) return 0;
+        if (d) d->kind = FD_INF;
+        field_match(f, "inity");
+        return 1;
+    }
+    if (tolower(c) == 'n') {
+        if (!field_match(f, "an")) return 0;
+        if (d) d->kind = FD_NAN;
+
+        // optional "(n-char-sequence)", of any length
+        FieldMark m = field_mark(f, EOF);
+        if (field_getc(f) == '(') {
+            for (;;) {
+                int ch = field_getc(f);
+                if (ch == ')') return 1;
+                if (ch == EOF || !(isalnum((unsigned char)ch) || ch == '_')) break;
+            }
+        }
+        field_rewind(f, m);
+        return 1;
+    }
+    return 0;
+}
+
+// Hex digits after "0x", optional '.', optional p exponent. *pc is the
+// first character after the prefix; on return it holds the terminator.
+static void scan_hexfloat(Field *f, int *pc, FloatDec *d) {
+    int c = *pc;
+
+    if (d) d->kind = FD_HEX;
+    c = field_digits(f, c, d, 1, 0);
+    if (c == '.') {
+        c = field_getc(f);
+        c = field_digits(f, c, d, 1, 1);
+    }
+    if (c == 'p' || c == 'P') {
+        FieldMark m = field_mark(f, c);
+        int esign = 1;
+        c = field_getc(f);
+        if (c == '+' || c == '-') {
+            if (c == '-') esign = -1;
+            c = field_getc(f);
+        }
+        if (!is_digit(c)) {
+            // no exponent after all: give back "p", "p+" ...
+            field_rewind(f, m);
+            *pc = EOF;
+            return;
+        }
+        int64_t e = 0;
+        while (is_digit(c)) {
+            if (e < 100000000) e = e * 10 + (c - '0');
+            c = field_getc(f);
+        }
+        if (d) d->exp += esign * e;
+    }
+    *pc = c;
+}
+
+// Decimal digits with optional '.', optional e exponent. Returns 0 if
+// there were no digits. On return *pc holds the terminator.
+static int scan_decfloat(Field *f, int *pc, FloatDec *d) {
+    int c = *pc;
+    int saw_digit = 0;
+
+    if (is_digit(c)) saw_digit = 1;
+    c = field_digits(f, c, d, 0, 0);
+    if (c == '.') {
+        c = field_getc(f);
+        if (is_digit(c)) saw_digit = 1;
+        c = field_digits(f, c, d, 0, 1);
+    }
+    *pc = c;
+    if (!saw_digit) return 0;
+
+    if (c == 'e' || c == 'E') {
+        FieldMark m = field_mark(f, c);
+        int esign = 1;
+        c = field_getc(f);
+        if (c == '+' || c == '-') {
+            if (c == '-') esign = -1;
+            c = field_getc(f);
+        }
+        if (!is_digit(c)) {
+            // not an exponent: give back "e", "e+" ...
+            field_rewind(f, m);
+            *pc = EOF;
+            return 1;
+        }
+        int64_t e = 0;
+        while (is_digit(c)) {
+            if (e < 100000000) e = e * 10 + (c - '0');   // saturates far past any finite result
+            c = field_getc(f);
+        }
+        if (d) d->exp += esign * e;
+        *pc = c;
+    }
+    return 1;
+}
+
+// Reads one floating-point field into d and *neg; returns 0 if there is none.
+// With d NULL (%*f) the same input is matched and consumed, and nothing
+// is built.
+static int read_float(Field *f, FloatDec *d, int *neg) {
+    int c = field_getc(f);
+    if (c == EOF) return 0;
+
+    if (c == '+' || c == '-') {
+        *neg = (c == '-');
+        c = field_getc(f);
+        if (c == EOF) return 0;
+    }
+
+    if (c == 'i' || c == 'I' || c == 'n' || c == 'N') {
+        if (!scan_infnan(f, c, d)) {
+            field_ungetc(f, c);
+            return 0;
+        }
+        c = field_getc(f);
+    } else {
+        int hex = 0;
+        if (c == '0') {
+            // "0x" starts a hex float only if a hex digit follows (possibly after '.')
+            FieldMark m = field_mark(f, EOF);
+            int c2 = field_getc(f);
+            if (c2 == 'x' || c2 == 'X') {
+                int c3 = field_getc(f);
+                int c4 = EOF;
+                if (c3 == '.') {
+                    c4 = field_getc(f);
+                    field_ungetc(f, c4);
+                }
+                if (hex_value(c3) >= 0 || hex_value(c4) >= 0) {
+                    hex = 1;
+                    c = c3;
+                } else {
+                    field_rewind(f, m);
+                }
+            } else {
+                field_ungetc(f, c2);
+            }
+        }
+
+        if (hex) {
+            scan_hexfloat(f, &c, d);
+        } else if (!scan_decfloat(f, &c, d)) {
+            field_ungetc(f, c);
+            return 0;
+        }
+    }
+
+    // Only unread if it is NOT whitespace (and not EOF)
+    if (c != EOF && !is_ws(c)) {
+        field_ungetc(f, c);
+    }
+    return 1;
+}
+
+static int scan_f(ScanCtx *ctx, const Spec *sp, void *dst) {
+    skip_input_ws(ctx);
+
+    Field f = { ctx, sp->width, 0 };   // width 0 = no limit
+    FloatDec d;
+    int neg = 0;
+    if (!sp->suppress) fd_init(&d);
+
+    ScanMark start = ctx_mark(ctx);
+    int ok = read_float(&f, sp->suppress ? NULL : &d, &neg);
+    ctx_release(ctx, start);
+    if (!ok) return 0;
+
+    if (sp->suppress) {
+        return 1;
+    }
+
+    if (sp->len == LEN_NONE) {          // %f
+        *(float*)dst = fd_to_float(&d, neg);
+    } else if (sp->len == LEN_L) {      // %lf
+        *(double*)dst = fd_to_double(&d, neg);
+    } else if (sp->len == LEN_CAP_L) {  // %Lf
+        *(long double*)dst = fd_to_long_double(&d, neg);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+
+/* =============================
+   Extensions: scan_q scan_b scan_D scan_r
+   ============================= */
+
+// Four hex digits of a \\u escape; -1, with nothing consumed, if they are not there.
+static long read_u4(ScanCtx *ctx) {
+    ScanMark m = ctx_mark(ctx);
+    long v = 0;
+    for (int i = 0; i < 4; i++) {
+        int d = hex_value(nextch(ctx));
+        if (d < 0) {
+            ctx_rewind(ctx, m);
+            v = -1;
+            break;
+        }
+        v = v << 4 | d;
+    }
+    ctx_release(ctx, m);
+    return v;
+}
+
+static size_t utf8_encode(long cp, unsigned char *u) {
+    if (cp < 0x80) {
+        u[0] = (unsigned char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        u[0] = (unsigned char)(0xC0 | cp >> 6);
+        u[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        u[0] = (unsigned char)(0xE0 | cp >> 12);
+        u[1] = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+        u[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    u[0] = (unsigned char)(0xF0 | cp >> 18);
+    u[1] = (unsigned char)(0x80 | (cp >> 12 & 0x3F));
+    u[2] = (unsigned char)(0x80 | (cp >> 6 & 0x3F));
+    u[3] = (unsigned char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// The escape after a backslash in %q: \\" \\\\ \\/ \\n \\t \\r \\b \\f and \\uXXXX
+// (UTF-8; a surrogate pair makes one character, a lone surrogate U+FFFD).
+// Anything else, or \\u without four hex digits, is kept as written. The
+// decoded bytes go to o only if all of them fit in *limit; if they don't,
+// *limit is cut to what o holds so nothing after them is stored either.
+// Returns 0 if o ran out of memory.
+static int q_escape(ScanCtx *ctx, StrOut *o, size_t *limit) {
+    unsigned char u[4];
+    size_t n = 1;
+    int c = nextch(ctx);
+    switch (c) {
+        case EOF: return 1;     // the missing closing quote fails %q
+        case '"': case '\\': case '/': u[0] = (unsigned char)c; break;
+        case 'n': u[0] = '\n'; break;
+        case 't': u[0] = '\t'; break;
+        case 'r': u[0] = '\r'; break;
+        case 'b': u[0] = '\b'; break;
+        case 'f': u[0] = '\f'; break;
+        case 'u': {
+            long cp = read_u4(ctx);
+            if (cp < 0) {
+                u[0] = '\\';
+                u[1] = 'u';
+                n = 2;
+                break;
+            }
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                // a high surrogate wants "\\u" and a low one right after it
+                ScanMark m = ctx_mark(ctx);
+                long lo = -1;
+                if (nextch(ctx) == '\\' && nextch(ctx) == 'u') lo = read_u4(ctx);
+                if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                } else {
+                    ctx_rewind(ctx, m);
+                    cp = 0xFFFD;
+                }
+                ctx_release(ctx, m);
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                cp = 0xFFFD;
+            }
+            n = utf8_encode(cp, u);
+            break;
+        }
+        default:
+            u[0] = '\\';
+            u[1] = (unsigned char)c;
+            n = 2;
+            break;
+    }
+    if (o->len + n > *limit) {
+        *limit = o->len;
+        return 1;
+    }
+    return so_write(o, u, n);
+}
+
+// %q: reads a quoted string (text inside double quotes, with backslash
+// escapes), or behaves like %s if not quote
+static int scan_q(ScanCtx *ctx, const Spec *sp, void *dst) {
+    skip_input_ws(ctx);
+
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;   // 0 = unlimited
+
+    StrOut o;
+    if (!so_open(&o, ctx, sp, dst)) return 0;
+
+    int c = nextch(ctx);
+    if (c == EOF) return 0;
+
+    if (c != '"') {
+        // fallback: behave like %s (read until whitespace)
+        unreadch(ctx, c);
+        if (so_token(&o, ctx, limit, NULL) == 0) return 0;
+        so_finish(&o, dst);
+        return 1;
+    }
+
+    // inside quotes: copy the runs between quotes and backslashes in
+    // blocks; past the width keep consuming until the closing quote
+    while (ctx->pos < ctx->len || refill(ctx)) {
+        const unsigned char *p = ctx->buf + ctx->pos;
+        const unsigned char *end = ctx->buf + ctx->len;
+        const unsigned char *stop = find_qesc(p, end);
+        size_t run = (size_t)(stop - p);
+        size_t keep = (o.len < limit) ? limit - o.len : 0;
+        if (keep > run) keep = run;
+        if (keep > 0 && !so_write(&o, p, keep)) return 0;
+        ctx->pos += run;
+        if (stop == end) continue;
+
+        ctx->pos++;
+        if (*stop == '"') {
+            so_finish(&o, dst);
+            return 1;
+        }
+        if (!o.buf) {
+            nextch(ctx);    // %*q: step over the escaped byte, decode nothing
+        } else if (!q_escape(ctx, &o, &limit)) {
+            return 0;
+        }
+    }
+
+    // EOF before closing quote: a caller buffer still gets what was read
+    if (!o.arena) so_finish(&o, dst);
+    return 0;
+}
+
+
+// %b: reads a binary integer (base 2), similar to %x for hex
+static int scan_b(ScanCtx *ctx, const Spec *sp, void *dst) {
+    skip_input_ws(ctx);
+
+    int limit = sp->width;
+    int used = 0;
+
+    int c = nextch(ctx);
+    if (c == EOF) return 0;
+
+    if (c != '0' && c != '1') { unreadch(ctx, c); return 0; }
+    used++;
+
+    size_t rest = (limit == 0) ? SIZE_MAX : (size_t)(limit - used);
+    if (sp->suppress && ctx->overflow_policy != MY_SCANF_OVERFLOW_FAIL) {
+        read_set(ctx, bin_set, NULL, rest);
+        return 1;
+    }
+    unsigned long long value = (unsigned long long)(c - '0');
+    int ovf = 0;
+    read_pow2_digits(ctx, &value, rest, 1, &ovf);
+
+    // store like %x using len
+    return store_unsigned(ctx, dst, sp->len, value, ovf);
+}
+
+
+static const unsigned long long pow10_u64[19] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL
+};
+
+// %.ND: [+-]digits[.digits] as an int64_t in units of 10^-N, exactly.
+// Both digit runs go through read_digits; digits past the scale follow
+// ctx->frac_policy. A rejected number is left unread. Width counts every
+// character.
+static int scan_D(ScanCtx *ctx, const Spec *sp, void *dst) {
+    skip_input_ws(ctx);
+
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;
+    size_t used = 0;
+    ScanMark start = ctx_mark(ctx);
+
+    int neg = 0;
+    int c = nextch(ctx);
+    if (c == '+' || c == '-') {
+        neg = (c == '-');
+        used++;
+    } else {
+        unreadch(ctx, c);
+    }
+
+    unsigned long long ip = 0, fp = 0;
+    int ovf = 0;
+    size_t nint = read_digits(ctx, &ip, limit - used, &ovf);
+    used += nint;
+
+    // the kept fractional digits, then the first one past them and
+    // whether any after that is nonzero
+    size_t nfrac = 0;
+    int first = 0, sticky = 0;
+    if (used < limit && (c = nextch(ctx)) == '.') {
+        used++;
+        size_t keep = (size_t)sp->prec < limit - used ? (size_t)sp->prec : limit - used;
+        nfrac = read_digits(ctx, &fp, keep, &ovf);
+        used += nfrac;
+        if (nfrac == (size_t)sp->prec && used < limit) {
+            if (is_digit(c = nextch(ctx))) {
+                first = c - '0';
+                used++;
+                while (used < limit && is_digit(c = nextch(ctx))) {
+                    sticky |= (c != '0');
+                    used++;
+                }
+                if (used < limit) unreadch(ctx, c);
+            } else {
+                unreadch(ctx, c);
+            }
+        }
+    } else if (used < limit) {
+        unreadch(ctx, c);
+    }
+
+    if (nint + nfrac == 0 ||
+        (ctx->frac_policy == MY_SCANF_FRAC_REJECT && (first || sticky))) {
+        ctx_rewind(ctx, start);
+        ctx_release(ctx, start);
+        return 0;
+    }
+    ctx_release(ctx, start);
+
+    // ip * 10^N + fp * 10^(N - nfrac), checked
+    unsigned long long mag;
+    if (__builtin_mul_overflow(ip, pow10_u64[sp->prec], &mag) ||
+        __builtin_add_overflow(mag, fp * pow10_u64[sp->prec - (int)nfrac], &mag)) ovf = 1;
+    if (ctx->frac_policy == MY_SCANF_FRAC_ROUND &&
+        (first > 5 || (first == 5 && (sticky || (mag & 1)))) &&
+        __builtin_add_overflow(mag, 1ULL, &mag)) ovf = 1;
+
+    long long v;
+    if (!store_signed(ctx, dst ? &v : NULL, LEN_LL, neg, mag, ovf)) return 0;
+    if (dst) *(int64_t *)dst = (int64_t)v;
+    return 1;
+}
+
+
+// %r: reads the remainder of the current line (until newline), excluding the newline;
+// %R also drops a '\r' before the newline (CRLF input)
+static int scan_r(ScanCtx *ctx, const Spec *sp, void *dst) {
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;
+
+    StrOut o;
+    if (!so_open(&o, ctx, sp, dst)) return 0;
+
+    size_t n;
+    int last;
+    if (so_line(&o, ctx, limit, &n, &last) <= 0) return 0;
+
+    // the '\r' was stored only if the line fit
+    if (sp->conv == 'R' && last == '\r' && n <= limit) o.len--;
+    so_finish(&o, dst);
+
+    return 1;
+}
+
+
+/* =============================
+   Views: scan_vs scan_vq scan_vr scan_vset
+   Same input rules as %s/%q/%r, but the destination is a ScanView on the
+   token's bytes in the input. Memory and mmap sources hand out pointers
+   into the input itself. Buffered sources hand out pointers into the
+   buffer, which are valid until the next call on the same context.
+   Width caps len the way it caps the copy.
+   ============================= */
+
+static int scan_vs(ScanCtx *ctx, const Spec *sp, void *dst) {
+    if (!dst) return scan_s(ctx, sp, NULL);
+    ScanView *v = (ScanView*)dst;
+
+    skip_input_ws(ctx);
+    if (!view_begin(ctx, v)) return 0;
+
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;
+    size_t n = read_token(ctx, NULL, limit);
+    if (n == 0) {
+        view_drop(ctx, v);
+        return 0;
+    }
+    v->len = n;
+    return 1;
+}
+
+static int scan_vset(ScanCtx *ctx, const Spec *sp, void *dst) {
+    if (!dst) return scan_set(ctx, sp, NULL);
+    ScanView *v = (ScanView*)dst;
+
+    if (!view_begin(ctx, v)) return 0;
+
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;
+    size_t n = read_set(ctx, sp->set, NULL, limit);
+    if (n == 0) {
+        view_drop(ctx, v);
+        return 0;
+    }
+    v->len = n;
+    return 1;
+}
+
+static int scan_vq(ScanCtx *ctx, const Spec *sp, void *dst) {
+    if (!dst) return scan_q(ctx, sp, NULL);
+    ScanView *v = (ScanView*)dst;
+
+    skip_input_ws(ctx);
+    int c = nextch(ctx);
+    if (c == EOF) return 0;
+    if (c != '"') {
+        unreadch(ctx, c);
+        return scan_vs(ctx, sp, dst);
+    }
+
+    if (!view_begin(ctx, v)) return 0;
+    size_t n = 0;
+    for (;;) {
+        if (ctx->pos == ctx->len && !refill(ctx)) {
+            // no closing quote
+            view_drop(ctx, v);
+            return 0;
+        }
+        const unsigned char *p = ctx->buf + ctx->pos;
+        const unsigned char *stop = find_qesc(p, ctx->buf + ctx->len);
+        n += (size_t)(stop - p);
+        ctx->pos += (size_t)(stop - p);
+        if (ctx->pos == ctx->len) continue;
+
+        ctx->pos++;
+        if (*stop == '"') break;
+        n++;                            // an escape stays as written
+        if (nextch(ctx) == EOF) continue;
+        n++;
+    }
+    v->len = (sp->width == 0 || n < (size_t)sp->width) ? n : (size_t)sp->width;
+    return 1;
+}
+
+static int scan_vr(ScanCtx *ctx, const Spec *sp, void *dst) {
+    if (!dst) return scan_r(ctx, sp, NULL);
+    ScanView *v = (ScanView*)dst;
+
+    if (!view_begin(ctx, v)) return 0;
+    StrOut o = { 0 };
+    size_t n;
+    int last;
+    if (so_line(&o, ctx, SIZE_MAX, &n, &last) == 0) {
+        view_drop(ctx, v);
+        return 0;
+    }
+    if (sp->conv == 'R' && last == '\r') n--;
+    v->len = (sp->width == 0 || n < (size_t)sp->width) ? n : (size_t)sp->width;
+    return 1;
+}
+
+
+/* =============================
+   Interned tokens: scan_is
+   %Is reads a token like %s and stores an unsigned ID instead of the
+   text: the same token always gets the same ID on a context, and
+   my_scanf_ctx_intern_str gives back its canonical copy.
+   ============================= */
+
+static int scan_is(ScanCtx *ctx, const Spec *sp, void *dst) {
+    skip_input_ws(ctx);
+
+    // the mark keeps the whole token in the buffer, so it is hashed in place
+    size_t limit = (sp->width == 0) ? SIZE_MAX : (size_t)sp->width;
+    ScanMark m = ctx_mark(ctx);
+    size_t n = read_token(ctx, NULL, limit);
+    const char *tok = (const char *)ctx->buf + (size_t)(m.at - ctx->base);
+    ctx_release(ctx, m);
+    if (n == 0) return 0;
+    if (!dst) return 1;
+    if (!ctx->interner) return 0;
+    if (ctx->starved) return 0;     // push scan cut short: the token may be partial and will be rescanned
+
+    long id = intern(ctx->interner, tok, n);
+    if (id < 0) return 0;
+    *(unsigned *)dst = (unsigned)id;
+    return 1;
+}
+
+
+/* =============================
+   Arrays: scan_array
+   %N,d reads N numbers separated by ',' (or ; : |, or only whitespace
+   with '_') into one array; %*,d reads up to *n of them and stores how
+   many it read in *n. The element conversion is picked once and then
+   called in a loop, with no per-element format or argument handling.
+   ============================= */
+
+static size_t array_elem_size(const Spec *sp) {
+    if (sp->conv == 'f') {
+        if (sp->len == LEN_L) return sizeof(double);
+        if (sp->len == LEN_CAP_L) return sizeof(long double);
+        return sizeof(float);
+    }
+    switch (sp->len) {
+        case LEN_HH: return sizeof(char);
+        case LEN_H:  return sizeof(short);
+        case LEN_L:  return sizeof(long);
+        case LEN_LL: return sizeof(long long);
+        default:     return sizeof(int);
+    }
+}
+
+static int scan_array(ScanCtx *ctx, const Spec *sp, void *dst) {
+    int (*fn)(ScanCtx *, const Spec *, void *);
+    switch (sp->conv) {
+        case 'd': fn = scan_d; break;
+        case 'x': fn = scan_x; break;
+        case 'b': fn = scan_b; break;
+        default:  fn = scan_f; break;
+    }
+    Spec el = *sp;      // one element: the same conversion without the count
+    el.count = 0;
+
+    size_t want = (size_t)sp->count, *got = NULL, size = array_elem_size(sp);
+    char *out = dst;
+    if (sp->count < 0) {
+        const ScanArray *a = dst;
+        got = a->n;
+        want = *a->n;
+        out = a->p;
+    }
+
+    size_t i;
+    for (i = 0; i < want; i++) {
+        // a separator without a number after it is given back
+        ScanMark m = ctx_mark(ctx);
+        int ok = 1;
+        if (i > 0 && sp->delim != '_') {
+            skip_input_ws(ctx);
+            int c = nextch(ctx);
+            ok = (c == (unsigned char)sp->delim);
+        }
+        if (ok) ok = fn(ctx, &el, out ? out + i * size : NULL);
+        if (!ok) ctx_rewind(ctx, m);
+        ctx_release(ctx, m);
+        if (!ok) break;
+    }
+    if (got) *got = i;
+    return got ? i > 0 : i == want;
+}
+
+
+/* =============================
+   Instrumentation (MY_SCANF_STATS)
+   Off by default; build with -DMY_SCANF_STATS=1 to count, per conversion
+   letter: calls, failures, input bytes consumed, pushback, and a log2
+   histogram of the time each call took (TSC ticks on x86, else ns).
+   Every thread counts into its own block with plain relaxed stores;
+   my_scanf_stats() adds up the blocks of running and exited threads.
+   ============================= */
+
+#define MY_SCANF_STAT_NCONV   16
+#define MY_SCANF_STAT_BUCKETS 32
+
+// Counters for one conversion letter.
+typedef struct {
+    char conv;                  // '\0' for an unused slot
+    uint64_t calls;
+    uint64_t failures;
+    uint64_t bytes;             // input consumed
+    uint64_t pushback_max;      // most characters one call gave back (unread or rewound)
+    uint64_t ticks[MY_SCANF_STAT_BUCKETS];  // ticks[k]: calls that took [2^k, 2^(k+1)) ticks
+} ScanConvStats;
+
+typedef struct {
+    ScanConvStats conv[MY_SCANF_STAT_NCONV];
+} ScanStats;
+
+// conversion letters, in slot order
+static const char stat_convs[] = "csdxfqbrR[D";
+
+#if MY_SCANF_STATS
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+enum { ST_CALLS, ST_FAILURES, ST_BYTES, ST_PB_MAX, ST_TICKS,
+       ST_N = ST_TICKS + MY_SCANF_STAT_BUCKETS };
+
+typedef struct StatBlock {
+    _Atomic uint64_t v[MY_SCANF_STAT_NCONV][ST_N];
+    struct StatBlock *next;
+} StatBlock;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static StatBlock *stats_live;       // blocks of running threads
+static uint64_t stats_retired[MY_SCANF_STAT_NCONV][ST_N];   // totals of exited threads
+static pthread_key_t stats_key;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static _Thread_local StatBlock *tstats;
+
+// Only the owning thread writes a block, so a relaxed load + store is enough.
+static inline void stat_add(_Atomic uint64_t *c, uint64_t n) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static inline void stat_max(_Atomic uint64_t *c, uint64_t n) {
+    if (n > atomic_load_explicit(c, memory_order_relaxed)) atomic_store_explicit(c, n, memory_order_relaxed);
+}
+
+static void stats_merge(uint64_t to[][ST_N], StatBlock *b) {
+    for (int k = 0; k < MY_SCANF_STAT_NCONV; k++) {
+        for (int i = 0; i < ST_N; i++) {
+            uint64_t v = atomic_load_explicit(&b->v[k][i], memory_order_relaxed);
+            if (i == ST_PB_MAX) { if (v > to[k][i]) to[k][i] = v; }
+            else to[k][i] += v;
+        }
+    }
+}
+
+// thread exit: fold the block into the retired totals
+static void stats_detach(void *p) {
+    StatBlock *b = p;
+    pthread_mutex_lock(&stats_lock);
+    StatBlock **pp = &stats_live;
+    while (*pp != b) pp = &(*pp)->next;
+    *pp = b->next;
+    stats_merge(stats_retired, b);
+    pthread_mutex_unlock(&stats_lock);
+    free(b);
+    tstats = NULL;
+}
+
+static void stats_key_init(void) {
+    pthread_key_create(&stats_key, stats_detach);
+}
+
+// NULL only when out of memory
+static StatBlock *stats_block(void) {
+    if (tstats) return tstats;
+
+    pthread_once(&stats_once, stats_key_init);
+    StatBlock *b = calloc(1, sizeof *b);
+    if (!b) return NULL;
+    pthread_mutex_lock(&stats_lock);
+    b->next = stats_live;
+    stats_live = b;
+    pthread_mutex_unlock(&stats_lock);
+    pthread_setspecific(stats_key, b);
+    tstats = b;
+    return b;
+}
+
+static inline uint64_t stat_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline uint64_t stat_offset(const ScanCtx *ctx) {
+    return ctx->base + ctx->pos;
+}
+
+// Runs one conversion and counts it.
+static int stat_conv(ScanCtx *ctx, int (*fn)(ScanCtx*, const Spec*, void*), const Spec *sp, void *dst) {
+    uint64_t at = stat_offset(ctx);
+    ctx->pb_count = 0;
+    uint64_t t0 = stat_ticks();
+
+    int ok = fn(ctx, sp, dst);
+
+    uint64_t t = stat_ticks() - t0;
+    const char *slot = strchr(stat_convs, sp->conv);
+    StatBlock *b = stats_block();
+    if (!b || !slot || !*slot) return ok;
+
+    _Atomic uint64_t *v = b->v[slot - stat_convs];
+    int bucket = t ? 63 - __builtin_clzll(t) : 0;
+    if (bucket >= MY_SCANF_STAT_BUCKETS) bucket = MY_SCANF_STAT_BUCKETS - 1;
+    stat_add(&v[ST_CALLS], 1);
+    if (!ok) stat_add(&v[ST_FAILURES], 1);
+    stat_add(&v[ST_BYTES], stat_offset(ctx) - at);
+    stat_max(&v[ST_PB_MAX], ctx->pb_count);
+    stat_add(&v[ST_TICKS + bucket], 1);
+    return ok;
+}
+#endif
+
+// Fills out with the counts of all threads so far. Returns 0 (and all
+// zeros) when the library was built without MY_SCANF_STATS.
+int my_scanf_stats(ScanStats *out) {
+    memset(out, 0, sizeof *out);
+    for (int k = 0; stat_convs[k]; k++) out->conv[k].conv = stat_convs[k];
+#if MY_SCANF_STATS
+    uint64_t sum[MY_SCANF_STAT_NCONV][ST_N];
+    pthread_mutex_lock(&stats_lock);
+    memcpy(sum, stats_retired, sizeof sum);
+    for (StatBlock *b = stats_live; b; b = b->next) stats_merge(sum, b);
+    pthread_mutex_unlock(&stats_lock);
+
+    for (int k = 0; k < MY_SCANF_STAT_NCONV; k++) {
+        ScanConvStats *c = &out->conv[k];
+        c->calls = sum[k][ST_CALLS];
+        c->failures = sum[k][ST_FAILURES];
+        c->bytes = sum[k][ST_BYTES];
+        c->pushback_max = sum[k][ST_PB_MAX];
+        memcpy(c->ticks, &sum[k][ST_TICKS], sizeof c->ticks);
+    }
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+// Zeroes every counter. Conversions running in other threads at the same
+// time may still add to the old values.
+void my_scanf_stats_reset(void) {
+#if MY_SCANF_STATS
+    pthread_mutex_lock(&stats_lock);
+    memset(stats_retired, 0, sizeof stats_retired);
+    for (StatBlock *b = stats_live; b; b = b->next) {
+        for (int k = 0; k < MY_SCANF_STAT_NCONV; k++) {
+            for (int i = 0; i < ST_N; i++) atomic_store_explicit(&b->v[k][i], 0, memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+#endif
+}
+
+
+/* =============================
+   Format programs: my_scanf_compile / my_scanf_exec
+   A format string is turned into an array of ops once: literal runs,
+   whitespace skips and conversions with width/length/suppress resolved.
+   ============================= */
+
+typedef int (*ConvFn)(ScanCtx *ctx, const Spec *sp, void *dst);
+
+typedef enum {
+    OP_LIT,     // match lit[0..lit_len) exactly
+    OP_WS,      // skip any amount of input whitespace
+    OP_CONV,    // run fn with the next argument as destination
+    OP_FAIL     // bad spec in a leniently compiled format: stop here
+} OpKind;
+
+typedef struct {
+    OpKind kind;
+    Spec sp;            // OP_CONV
+    ConvFn fn;          // OP_CONV
+    const char *lit;    // OP_LIT
+    int lit_len;        // OP_LIT
+} Op;
+
+typedef struct ScanProg {
+    int nops;
+    Op *ops;
+    char *src;          // copy of the format; literal runs point into lit_text
+    char *lit_text;
+} ScanProg;
+
+static ConvFn conv_fn(const Spec *sp) {
+    if (sp->alloc && !(sp->len == LEN_NONE && strchr("sqrR[", sp->conv)))
+        return NULL;
+    if (sp->prec != 0 && sp->conv != 'D') return NULL;
+    if (sp->count != 0) {
+        if (sp->view || sp->alloc || sp->intern || !strchr("dxbf", sp->conv)) return NULL;
+        if (sp->conv == 'f' ? (sp->len != LEN_NONE && sp->len != LEN_L && sp->len != LEN_CAP_L)
+                            : sp->len == LEN_CAP_L) return NULL;
+        return scan_array;
+    }
+    if (sp->intern) return (sp->len == LEN_NONE && sp->conv == 's') ? scan_is : NULL;
+    if (sp->view) {
+        if (sp->len != LEN_NONE) return NULL;
+        switch (sp->conv) {
+            case 's': return scan_vs;
+            case 'q': return scan_vq;
+            case 'r': case 'R': return scan_vr;
+            case '[': return scan_vset;
+            default: return NULL;
+        }
+    }
+    switch (sp->conv) {
+        case 'c': return scan_c;
+        case 's': return scan_s;
+        case 'q': return scan_q;
+        case 'r': case 'R': return scan_r;
+        case '[':
+            if (sp->len == LEN_NONE) return scan_set;
+            return NULL;
+        case 'd':
+            if (sp->len != LEN_CAP_L) return scan_d;
+            return NULL;
+        case 'x':
+            if (sp->len != LEN_CAP_L) return scan_x;
+            return NULL;
+        case 'b':
+            if (sp->len != LEN_CAP_L) return scan_b;
+            return NULL;
+        case 'f':
+            if (sp->len == LEN_NONE || sp->len == LEN_L || sp->len == LEN_CAP_L) return scan_f;
+            return NULL;
+        case 'D':
+            if (sp->len == LEN_NONE && sp->prec <= 18) return scan_D;
+            return NULL;
+        default:
+            return NULL;   // unknown conversion
+    }
+}
+
+// Decodes one op from the format at *pp.
+// Returns 1 and advances *pp, 0 at end of format, -1 on a bad spec (*pp stays at the '%').
+static int next_op(const char **pp, Op *op) {
+    const char *p = *pp;
+    if (*p == '\0') return 0;
+
+    if (*p == '%') {
+        const char *q = p + 1;
+        if (*q == '%') {
+            // "%%" matches a single literal '%'
+            op->kind = OP_LIT;
+            op->lit = q;
+            op->lit_len = 1;
+            *pp = q + 1;
+            return 1;
+        }
+        if (!parse_spec(&q, &op->sp)) return -1;     // dangling '%'
+        op->fn = conv_fn(&op->sp);
+        if (op->fn == NULL) return -1;               // unknown conversion / length
+        op->kind = OP_CONV;
+        *pp = q;
+        return 1;
+    }
+
+    if (isspace((unsigned char)*p)) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        op->kind = OP_WS;
+        *pp = p;
+        return 1;
+    }
+
+    const char *start = p;
+    while (*p && *p != '%' && !isspace((unsigned char)*p)) p++;
+    op->kind = OP_LIT;
+    op->lit = start;
+    op->lit_len = (int)(p - start);
+    *pp = p;
+    return 1;
+}
+
+// Where conversion results go: the next varargs pointer, the next field
+// of a record (rec + off[k]), or the next column (cols[k] + index * col_size[k]).
+typedef struct {
+    va_list *ap;            // NULL: use a record or columns
+    char *rec;
+    const size_t *off;
+    char *const *cols;      // non-NULL: columns instead of a record
+    const size_t *col_size;
+    size_t index;
+    int next;
+} ArgSrc;
+
+static inline void *next_arg(ArgSrc *args) {
+    if (args->ap) return va_arg(*args->ap, void*);
+    int k = args->next++;
+    if (args->cols) return args->cols[k] + args->index * args->col_size[k];
+    return args->rec + args->off[k];
+}
+
+// Matches lit[0..len) exactly against the input.
+static int match_lit(ScanCtx *ctx, const char *lit, int len) {
+    for (int i = 0; i < len; i++) {
+        int c = nextch(ctx);
+        if (c != (unsigned char)lit[i]) {
+            if (c != EOF) unreadch(ctx, c);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Runs one op. Returns 1 to continue, 0 to stop scanning.
+static int run_op(ScanCtx *ctx, const Op *op, ArgSrc *args, int *assigned) {
+    switch (op->kind) {
+        case OP_LIT:
+            return match_lit(ctx, op->lit, op->lit_len);
+
+        case OP_WS:
+            skip_input_ws(ctx);
+            return 1;
+
+        case OP_CONV: {
+            void *dst = op->sp.suppress ? NULL : next_arg(args);
+            ScanArray arr;
+            if (op->sp.count < 0) {     // %*,d: the count, then the array
+                arr.n = dst;
+                arr.p = next_arg(args);
+                dst = &arr;
+            }
+#if MY_SCANF_STATS
+            if (!stat_conv(ctx, op->fn, &op->sp, dst)) return 0;
+#else
+            if (!op->fn(ctx, &op->sp, dst)) return 0;
+#endif
+            if (!op->sp.suppress) (*assigned)++;
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+static int exec_prog(ScanCtx *ctx, const ScanProg *prog, ArgSrc *args) {
+    int assigned = 0;
+    for (int i = 0; i < prog->nops; i++) {
+        if (!run_op(ctx, &prog->ops[i], args, &assigned)) break;
+    }
+    return assigned;
+}
+
+static int exec_prog_va(ScanCtx *ctx, const ScanProg *prog, va_list *ap) {
+    ArgSrc args = { .ap = ap };
+    ctx_begin(ctx);
+    return exec_prog(ctx, prog, &args);
+}
+
+// Walks the format directly, one op at a time (used when no program is available).
+static int exec_fmt(ScanCtx *ctx, const char *fmt, va_list *ap) {
+    ArgSrc args = { .ap = ap };
+    ctx_begin(ctx);
+    int assigned = 0;
+    const char *p = fmt;
+    Op op;
+    while (next_op(&p, &op) > 0) {
+        if (!run_op(ctx, &op, &args, &assigned)) break;
+    }
+    return assigned;
+}
+
+void my_scanf_free(ScanProg *prog);
+
+// strict: a bad spec fails the compile (errp gets its position);
+// otherwise it becomes OP_FAIL, which stops scanning just like my_scanf would.
+static ScanProg *compile_fmt(const char *fmt, int strict, const char **errp) {
+    if (errp) *errp = NULL;     // stays NULL unless a bad spec is found
+    size_t n = strlen(fmt);
+    ScanProg *prog = malloc(sizeof *prog);
+    if (!prog) return NULL;
+
+    // every op consumes at least one format byte, so n+1 ops is always enough
+    prog->ops = malloc((n + 1) * sizeof(Op));
+    prog->src = malloc(2 * (n + 1));
+    if (!prog->ops || !prog->src) {
+        free(prog->ops);
+        free(prog->src);
+        free(prog);
+        return NULL;
+    }
+    memcpy(prog->src, fmt, n + 1);
+    prog->lit_text = prog->src + n + 1;
+    prog->nops = 0;
+
+    char *lit_end = prog->lit_text;
+    const char *p = fmt;
+    Op op;
+    int r;
+    while ((r = next_op(&p, &op)) != 0) {
+        if (r < 0) {
+            if (strict) {
+                if (errp) *errp = p;
+                my_scanf_free(prog);
+                return NULL;
+            }
+            op.kind = OP_FAIL;
+            prog->ops[prog->nops++] = op;
+            break;
+        }
+
+        if (op.kind == OP_LIT) {
+            // merge adjacent literals (including "%%") into one run
+            Op *prev = prog->nops ? &prog->ops[prog->nops - 1] : NULL;
+            memcpy(lit_end, op.lit, (size_t)op.lit_len);
+            if (prev && prev->kind == OP_LIT) {
+                prev->lit_len += op.lit_len;
+            } else {
+                op.lit = lit_end;
+                prog->ops[prog->nops++] = op;
+            }
+            lit_end += op.lit_len;
+            continue;
+        }
+        prog->ops[prog->nops++] = op;
+    }
+    return prog;
+}
+
+// Compiles fmt once; returns NULL on a format error (with *errp, if given,
+// pointing at the offending '%') or when out of memory (*errp == NULL).
+ScanProg *my_scanf_compile(const char *fmt, const char **errp) {
+    return compile_fmt(fmt, 1, errp);
+}
+
+void my_scanf_free(ScanProg *prog) {
+    if (!prog) return;
+    free(prog->ops);
+    free(prog->src);
+    free(prog);
+}
+
+/* =============================
+   Alternative formats: my_scanf_alt
+   Several formats are compiled into one prefix trie of ops. Literal runs
+   are split at the first byte where two formats differ, so a shared
+   prefix is matched once and the scan only branches where the formats
+   do. The branches are explored as suppressed conversions, which store
+   nothing, each from a mark it is rewound to when it fails. Only the
+   winning format is then scanned with the caller's arguments.
+   ============================= */
+
+typedef struct {
+    Op op;          // matched on the way down from the parent (unused at the root)
+    Spec chk;       // for a conversion: op.sp suppressed, to validate without storing
+    ConvFn chk_fn;
+    int fmt;        // index of the format that ends here, or -1
+    int min_fmt;    // lowest format index in this subtree; siblings are in this order
+    int parent;
+    int child;      // first child, or -1
+    int next;       // next sibling, or -1
+} AltNode;
+
+typedef struct ScanAlt {
+    int nfmts;
+    ScanProg **progs;   // one per format; literal ops point into their text
+    int nnodes;
+    int cap;
+    AltNode *nodes;     // nodes[0] is the root
+} ScanAlt;
+
+static int spec_equal(const Spec *a, const Spec *b) {
+    return a->width == b->width && a->len == b->len && a->conv == b->conv &&
+           a->suppress == b->suppress && a->view == b->view && a->alloc == b->alloc &&
+           a->intern == b->intern && a->count == b->count && a->delim == b->delim &&
+           a->prec == b->prec &&
+           (a->conv != '[' || memcmp(a->set, b->set, sizeof a->set) == 0);
+}
+
+// Appends a node under parent, as its last child; -1 if out of memory.
+static int alt_node(ScanAlt *alt, int parent, const Op *op, int fmt) {
+    if (alt->nnodes == alt->cap) {
+        int cap = alt->cap ? alt->cap * 2 : 16;
+        AltNode *nodes = realloc(alt->nodes, (size_t)cap * sizeof *nodes);
+        if (!nodes) return -1;
+        alt->nodes = nodes;
+        alt->cap = cap;
+    }
+    int k = alt->nnodes++;
+    AltNode *n = &alt->nodes[k];
+    if (op) n->op = *op;
+    if (op && op->kind == OP_CONV) {
+        n->chk = op->sp;
+        n->chk.suppress = 1;
+        n->chk.view = 0;
+        n->chk.alloc = 0;
+        n->chk_fn = conv_fn(&n->chk);
+    }
+    n->fmt = -1;
+    n->min_fmt = fmt;
+    n->parent = parent;
+    n->child = -1;
+    n->next = -1;
+    if (parent >= 0) {
+        int *link = &alt->nodes[parent].child;
+        while (*link >= 0) link = &alt->nodes[*link].next;
+        *link = k;
+    }
+    return k;
+}
+
+// Splits literal node k after its first m bytes: a new node with those
+// bytes takes k's place among its siblings, and k becomes its only child.
+static int alt_split(ScanAlt *alt, int k, int m) {
+    int s = alt_node(alt, -1, &alt->nodes[k].op, alt->nodes[k].min_fmt);
+    if (s < 0) return -1;
+    AltNode *nodes = alt->nodes;
+    int *link = &nodes[nodes[k].parent].child;
+    while (*link != k) link = &nodes[*link].next;
+    *link = s;
+    nodes[s].parent = nodes[k].parent;
+    nodes[s].next = nodes[k].next;
+    nodes[s].child = k;
+    nodes[s].op.lit_len = m;
+    nodes[k].parent = s;
+    nodes[k].next = -1;
+    nodes[k].op.lit += m;
+    nodes[k].op.lit_len -= m;
+    return s;
+}
+
+// Adds format number fmt to the trie. 0 if out of memory.
+static int alt_insert(ScanAlt *alt, const ScanProg *prog, int fmt) {
+    int at = 0;
+    for (int i = 0; i < prog->nops; i++) {
+        Op op = prog->ops[i];
+        for (;;) {
+            // the child that shares a prefix with op, and how long the prefix is
+            int c, m = 0;
+            for (c = alt->nodes[at].child; c >= 0; c = alt->nodes[c].next) {
+                const Op *o = &alt->nodes[c].op;
+                if (o->kind != op.kind) continue;
+                if (op.kind == OP_LIT) {
+                    while (m < o->lit_len && m < op.lit_len && o->lit[m] == op.lit[m]) m++;
+                    if (m > 0) break;
+                } else if (op.kind == OP_WS || (o->fn == op.fn && spec_equal(&o->sp, &op.sp))) {
+                    break;
+                }
+            }
+            if (c < 0) {
+                at = alt_node(alt, at, &op, fmt);
+                if (at < 0) return 0;
+                break;
+            }
+            if (op.kind != OP_LIT) {
+                at = c;
+                break;
+            }
+            if (m < alt->nodes[c].op.lit_len && (c = alt_split(alt, c, m)) < 0) return 0;
+            at = c;
+            op.lit += m;
+            op.lit_len -= m;
+            if (op.lit_len == 0) break;
+        }
+    }
+    if (alt->nodes[at].fmt < 0) alt->nodes[at].fmt = fmt;   // a duplicate format never wins
+    return 1;
+}
+
+void my_scanf_alt_free(ScanAlt *alt) {
+    if (!alt) return;
+    for (int i = 0; i < alt->nfmts; i++) my_scanf_free(alt->progs[i]);
+    free(alt->progs);
+    free(alt->nodes);
+    free(alt);
+}
+
+// Compiles formats[0..n) into one trie. NULL on a bad spec (*errp, if
+// given, points at it in its format, or at the start of a format with an
+// array sized by an argument, which can't be checked without storing) or
+// when out of memory (*errp == NULL).
+ScanAlt *my_scanf_alt_compile(const char *const *formats, int n, const char **errp) {
+    if (errp) *errp = NULL;
+    ScanAlt *alt = calloc(1, sizeof *alt);
+    if (!alt) return NULL;
+    alt->progs = calloc(n > 0 ? (size_t)n : 1, sizeof *alt->progs);
+    if (!alt->progs || alt_node(alt, -1, NULL, 0) < 0) {
+        my_scanf_alt_free(alt);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        alt->progs[i] = compile_fmt(formats[i], 1, errp);
+        if (!alt->progs[i]) {
+            my_scanf_alt_free(alt);
+            return NULL;
+        }
+        alt->nfmts = i + 1;
+        for (int k = 0; k < alt->progs[i]->nops; k++) {
+            const Op *op = &alt->progs[i]->ops[k];
+            if (op->kind == OP_CONV && op->sp.count < 0) {
+                if (errp) *errp = formats[i];
+                my_scanf_alt_free(alt);
+                return NULL;
+            }
+        }
+        if (!alt_insert(alt, alt->progs[i], i)) {
+            my_scanf_alt_free(alt);
+            return NULL;
+        }
+    }
+    return alt;
+}
+
+typedef struct {
+    ScanCtx *ctx;
+    const AltNode *nodes;
+    int best;       // lowest format matched so far (nfmts: none yet)
+    int best_node;
+} AltRun;
+
+// Matches node's op against the input without storing anything.
+static int alt_check(ScanCtx *ctx, const AltNode *node) {
+    switch (node->op.kind) {
+        case OP_LIT:  return match_lit(ctx, node->op.lit, node->op.lit_len);
+        case OP_WS:   skip_input_ws(ctx); return 1;
+        case OP_CONV: return node->chk_fn(ctx, &node->chk, NULL);
+        default:      return 0;
+    }
+}
+
+// Tries the subtree below node at, whose op has just matched. Children
+// run in format order and are skipped once they cannot beat r->best.
+// Leaves the cursor after the best match found in the subtree, if any.
+static void alt_walk(AltRun *r, int at) {
+    const AltNode *node = &r->nodes[at];
+
+    // a run without branches needs no mark: the caller undoes a failure
+    while (node->fmt < 0 && node->child >= 0 && r->nodes[node->child].next < 0) {
+        if (r->nodes[node->child].min_fmt >= r->best) return;
+        if (!alt_check(r->ctx, &r->nodes[node->child])) return;
+        at = node->child;
+        node = &r->nodes[at];
+    }
+
+    ScanMark m = ctx_mark(r->ctx);
+    int tried = 0;
+
+    for (int c = node->child; c >= 0 && r->nodes[c].min_fmt < r->best; c = r->nodes[c].next) {
+        if (node->fmt >= 0 && node->fmt < r->nodes[c].min_fmt) break;   // this node's format comes first
+        if (tried) ctx_rewind(r->ctx, m);
+        tried = 1;
+        if (alt_check(r->ctx, &r->nodes[c])) alt_walk(r, c);
+    }
+
+    if (node->fmt >= 0 && node->fmt < r->best) {
+        if (tried) ctx_rewind(r->ctx, m);
+        r->best = node->fmt;
+        r->best_node = at;
+    }
+    ctx_release(r->ctx, m);
+}
+
+// Runs the ops on the path from the root to node at, in order.
+static int alt_replay(ScanCtx *ctx, const AltNode *nodes, int at, ArgSrc *args) {
+    if (at == 0) return 1;
+    if (!alt_replay(ctx, nodes, nodes[at].parent, args)) return 0;
+    int assigned = 0;
+    return run_op(ctx, &nodes[at].op, args, &assigned);
+}
+
+// Returns the index of the first format, in list order, that matched in
+// full, with the input after it consumed; -1 if none did (input untouched).
+static int exec_alt(ScanCtx *ctx, const ScanAlt *alt, va_list *ap) {
+    ctx_begin(ctx);
+    ScanMark start = ctx_mark(ctx);
+    AltRun r = { ctx, alt->nodes, alt->nfmts, 0 };
+    alt_walk(&r, 0);
+
+    if (r.best < alt->nfmts) {
+        // the winner is the only format that sees the arguments
+        ctx_rewind(ctx, start);
+        va_list cp;
+        va_copy(cp, *ap);
+        ArgSrc args = { .ap = &cp };
+        if (!alt_replay(ctx, alt->nodes, r.best_node, &args)) r.best = alt->nfmts;
+        va_end(cp);
+    }
+    if (r.best == alt->nfmts) {
+        ctx_rewind(ctx, start);
+        ctx->nviews = 0;
+        r.best = -1;
+    }
+    ctx_release(ctx, start);
+    return r.best;
+}
+
+
+/* =============================
+   Format cache: lets plain my_scanf calls reuse compiled programs.
+   Keyed by the format pointer; the stored copy of the text is compared
+   too, so a reused buffer with new contents is simply recompiled.
+   Each thread has its own cache (see ThreadState).
+   ============================= */
+
+#ifndef MY_SCANF_FMT_CACHE
+#define MY_SCANF_FMT_CACHE 16   // number of slots; 0 disables the cache
+#endif
+
+#if MY_SCANF_FMT_CACHE > 0
+typedef struct {
+    const char *key;
+    ScanProg *prog;
+} FmtCacheEntry;
+
+static const ScanProg *fmt_cache_get(FmtCacheEntry *cache, const char *fmt) {
+    size_t slot = ((uintptr_t)fmt >> 3) % MY_SCANF_FMT_CACHE;
+    FmtCacheEntry *e = &cache[slot];
+
+    if (e->key == fmt && strcmp(e->prog->src, fmt) == 0) return e->prog;
+
+    ScanProg *prog = compile_fmt(fmt, 0, NULL);
+    if (!prog) return NULL;
+    my_scanf_free(e->prog);
+    e->key = fmt;
+    e->prog = prog;
+    return prog;
+}
+
+// One slot for my_scanf_alt: the formats array pointer, checked the same way.
+typedef struct {
+    const char *const *key;
+    ScanAlt *alt;
+} AltCacheEntry;
+
+static const ScanAlt *alt_cache_get(AltCacheEntry *e, const char *const *formats, int n) {
+    if (e->key == formats && e->alt->nfmts == n) {
+        int i = 0;
+        while (i < n && strcmp(e->alt->progs[i]->src, formats[i]) == 0) i++;
+        if (i == n) return e->alt;
+    }
+
+    ScanAlt *alt = my_scanf_alt_compile(formats, n, NULL);
+    if (!alt) return NULL;
+    my_scanf_alt_free(e->alt);
+    e->key = formats;
+    e->alt = alt;
+    return alt;
+}
+#endif
+
+
+/* =============================
+   Per-thread state: the default context (on stdin) and the format cache.
+   Allocated on first use, freed when the thread exits.
+   ============================= */
+
+#include <pthread.h>
+
+typedef struct {
+    ScanCtx ctx;
+    unsigned char buf[INBUF_SIZE];
+#if MY_SCANF_FMT_CACHE > 0
+    FmtCacheEntry cache[MY_SCANF_FMT_CACHE];
+    AltCacheEntry alt_cache;
+#endif
+} ThreadState;
+
+static pthread_key_t tstate_key;
+static pthread_once_t tstate_once = PTHREAD_ONCE_INIT;
+static _Thread_local ThreadState *tstate;
+
+static void tstate_free(void *p) {
+    ThreadState *ts = p;
+#if MY_SCANF_FMT_CACHE > 0
+    for (int i = 0; i < MY_SCANF_FMT_CACHE; i++) my_scanf_free(ts->cache[i].prog);
+    my_scanf_alt_free(ts->alt_cache.alt);
+#endif
+    if (ts->ctx.own_buf) free(ts->ctx.buf);   // grown past ts->buf for views
+    free(ts->ctx.views);
+    arena_free(&ts->ctx.own_arena);
+    intern_free(&ts->ctx.own_interner);
+    free(ts);
+    tstate = NULL;
+}
+
+static void tstate_key_init(void) {
+    pthread_key_create(&tstate_key, tstate_free);
+}
+
+// NULL only when out of memory
+static ThreadState *thread_state(void) {
+    if (tstate) return tstate;
+
+    pthread_once(&tstate_once, tstate_key_init);
+    ThreadState *ts = calloc(1, sizeof *ts);
+    if (!ts) return NULL;
+    ctx_init(&ts->ctx, SRC_FD, ts->buf, INBUF_SIZE);
+    ts->ctx.arena = &ts->ctx.own_arena;
+    ts->ctx.interner = &ts->ctx.own_interner;
+    ts->ctx.fd = STDIN_FILENO;
+    pthread_setspecific(tstate_key, ts);
+    tstate = ts;
+    return ts;
+}
+
+static int vscan(ScanCtx *ctx, const char *fmt, va_list *ap) {
+#if MY_SCANF_FMT_CACHE > 0
+    ThreadState *ts = thread_state();
+    const ScanProg *prog = ts ? fmt_cache_get(ts->cache, fmt) : NULL;
+    if (prog) return exec_prog_va(ctx, prog, ap);
+#endif
+    return exec_fmt(ctx, fmt, ap);
+}
+
+
+/* =============================
+   Scanner contexts: independent input, buffer and pushback per ScanCtx.
+   A context must only be used by one thread at a time.
+   ============================= */
+
+static ScanCtx *ctx_new_buffered(SrcKind src) {
+    ScanCtx *ctx = malloc(sizeof *ctx);
+    unsigned char *buf = malloc(INBUF_SIZE);
+    if (!ctx || !buf) {
+        free(ctx);
+        free(buf);
+        return NULL;
+    }
+    ctx_init(ctx, src, buf, INBUF_SIZE);
+    ctx->own_buf = 1;
+    ctx->arena = &ctx->own_arena;
+    ctx->interner = &ctx->own_interner;
+    return ctx;
+}
+
+// New context reading from fd (not closed by my_scanf_ctx_free); NULL if out of memory.
+ScanCtx *my_scanf_ctx_new(int fd) {
+    ScanCtx *ctx = ctx_new_buffered(SRC_FD);
+    if (ctx) ctx->fd = fd;
+    return ctx;
+}
+
+// New context reading from fp with fread (fp is not closed by my_scanf_ctx_free).
+// Bytes read ahead stay in the context, as they would with an fd.
+ScanCtx *my_scanf_ctx_new_file(FILE *fp) {
+    ScanCtx *ctx = ctx_new_buffered(SRC_FILE);
+    if (ctx) ctx->fp = fp;
+    return ctx;
+}
+
+// New context scanning [data, data+len) in place; data must outlive the context.
+ScanCtx *my_scanf_ctx_new_mem(const char *data, size_t len) {
+    ScanCtx *ctx = malloc(sizeof *ctx);
+    if (ctx) {
+        ctx_init_mem(ctx, data, len);
+        ctx->arena = &ctx->own_arena;
+        ctx->interner = &ctx->own_interner;
+    }
+    return ctx;
+}
+
+// New context over a read-only mapping of the file at path; conversions
+// read straight from the page cache. NULL (with errno set) on failure.
+ScanCtx *my_scanf_ctx_open_mmap(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t len = (size_t)st.st_size;
+    void *map = NULL;
+    if (len > 0) {
+        map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+        madvise(map, len, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    ScanCtx *ctx = malloc(sizeof *ctx);
+    if (!ctx) {
+        if (map) munmap(map, len);
+        return NULL;
+    }
+    ctx_init_mem(ctx, map, len);
+    ctx->src = SRC_MMAP;
+    ctx->arena = &ctx->own_arena;
+    ctx->interner = &ctx->own_interner;
+    return ctx;
+}
+
+void my_scanf_ctx_free(ScanCtx *ctx) {
+    if (!ctx) return;
+    if (ctx->src == SRC_MMAP && ctx->cap > 0) munmap(ctx->buf, ctx->cap);
+    if (ctx->own_buf) free(ctx->buf);
+    free(ctx->views);
+    arena_free(&ctx->own_arena);
+    intern_free(&ctx->own_interner);
+    free(ctx);
+}
+
+void my_scanf_ctx_set_overflow(ScanCtx *ctx, int policy) {
+    ctx->overflow_policy = policy;
+}
+
+void my_scanf_ctx_set_fraction(ScanCtx *ctx, int policy) {
+    ctx->frac_policy = policy;
+}
+
+// Releases every %m string scanned on ctx; the memory is reused.
+void my_scanf_ctx_arena_reset(ScanCtx *ctx) {
+    arena_reset(&ctx->own_arena);
+}
+
+// The ID %Is stores on ctx for the token str[0..len), which is added if it
+// is new (so it can be compared with scanned IDs); -1 if out of memory.
+long my_scanf_ctx_intern(ScanCtx *ctx, const char *str, size_t len) {
+    return intern(&ctx->own_interner, str, len);
+}
+
+// The canonical, NUL-terminated copy of token id on ctx (valid until the
+// context is freed), or NULL if no token has that ID. len may be NULL.
+const char *my_scanf_ctx_intern_str(ScanCtx *ctx, unsigned id, size_t *len) {
+    const Interner *t = &ctx->own_interner;
+    if (id >= t->count) return NULL;
+    if (len) *len = t->entries[id].len;
+    return t->entries[id].ptr;
+}
+
+int my_vscanf_ctx(ScanCtx *ctx, const char *fmt, va_list ap) {
+    va_list cp;
+    va_copy(cp, ap);
+    int assigned = vscan(ctx, fmt, &cp);
+    va_end(cp);
+    return assigned;
+}
+
+int my_scanf_ctx(ScanCtx *ctx, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int assigned = vscan(ctx, fmt, &ap);
+    va_end(ap);
+    return assigned;
+}
+
+// Runs a compiled program; returns number of successful assignments.
+int my_scanf_exec_ctx(ScanCtx *ctx, const ScanProg *prog, ...) {
+    va_list ap;
+    va_start(ap, prog);
+    int assigned = exec_prog_va(ctx, prog, &ap);
+    va_end(ap);
+    return assigned;
+}
+
+// Runs compiled alternatives; returns the index of the format that matched, or -1.
+int my_scanf_alt_exec_ctx(ScanCtx *ctx, const ScanAlt *alt, ...) {
+    va_list ap;
+    va_start(ap, alt);
+    int which = exec_alt(ctx, alt, &ap);
+    va_end(ap);
+    return which;
+}
+
+static int vscan_alt(ScanCtx *ctx, const char *const *formats, int n, va_list *ap) {
+#if MY_SCANF_FMT_CACHE > 0
+    ThreadState *ts = thread_state();
+    const ScanAlt *alt = ts ? alt_cache_get(&ts->alt_cache, formats, n) : NULL;
+    if (alt) return exec_alt(ctx, alt, ap);
+#endif
+    const char *err;
+    ScanAlt *own = my_scanf_alt_compile(formats, n, &err);
+    if (!own) {
+        errno = err ? EINVAL : ENOMEM;
+        return -1;
+    }
+    int which = exec_alt(ctx, own, ap);
+    my_scanf_alt_free(own);
+    return which;
+}
+
+// Tries formats[0..n) on ctx; see my_scanf_alt.
+int my_scanf_alt_ctx(ScanCtx *ctx, const char *const *formats, int n, ...) {
+    va_list ap;
+    va_start(ap, n);
+    int which = vscan_alt(ctx, formats, n, &ap);
+    va_end(ap);
+    return which;
+}
+
+
+/* =============================
+   my_scanf: dispatcher on the calling thread's stdin context
+   Returns number of successful assignments.
+   ============================= */
+
+void my_scanf_set_overflow(int policy) {
+    ThreadState *ts = thread_state();
+    if (ts) ts->ctx.overflow_policy = policy;
+}
+
+// What %.ND does with more than N fractional digits: MY_SCANF_FRAC_*.
+void my_scanf_set_fraction(int policy) {
+    ThreadState *ts = thread_state();
+    if (ts) ts->ctx.frac_policy = policy;
+}
+
+// Releases the %m strings of this thread's my_scanf, my_sscanf and my_fscanf calls.
+void my_scanf_arena_reset(void) {
+    ThreadState *ts = thread_state();
+    if (ts) arena_reset(&ts->ctx.own_arena);
+}
+
+// my_scanf_ctx_intern / my_scanf_ctx_intern_str for the table shared by
+// this thread's my_scanf, my_sscanf and my_fscanf calls.
+long my_scanf_intern(const char *str, size_t len) {
+    ThreadState *ts = thread_state();
+    return ts ? my_scanf_ctx_intern(&ts->ctx, str, len) : -1;
+}
+
+const char *my_scanf_intern_str(unsigned id, size_t *len) {
+    ThreadState *ts = thread_state();
+    return ts ? my_scanf_ctx_intern_str(&ts->ctx, id, len) : NULL;
+}
+
+int my_scanf_exec(const ScanProg *prog, ...) {
+    ThreadState *ts = thread_state();
+    if (!ts) return 0;
+
+    va_list ap;
+    va_start(ap, prog);
+    int assigned = exec_prog_va(&ts->ctx, prog, &ap);
+    va_end(ap);
+    return assigned;
+}
+
+int my_vscanf(const char *fmt, va_list ap) {
+    ThreadState *ts = thread_state();
+    if (!ts) return 0;
+    return my_vscanf_ctx(&ts->ctx, fmt, ap);
+}
+
+int my_scanf(const char *fmt, ...) {
+    ThreadState *ts = thread_state();
+    if (!ts) return 0;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int assigned = vscan(&ts->ctx, fmt, &ap);
+    va_end(ap);
+    return assigned;
+}
+
+// Scans stdin with whichever of formats[0..n) matches: the first one, in
+// list order, whose whole format matches. Every format takes its
+// arguments from the start of the list. Returns that format's index, or
+// -1 if none matched (nothing is consumed) or a format is bad (errno EINVAL).
+// Arguments of formats that did not win may have been written.
+int my_scanf_alt(const char *const *formats, int n, ...) {
+    ThreadState *ts = thread_state();
+    if (!ts) return -1;
+
+    va_list ap;
+    va_start(ap, n);
+    int which = vscan_alt(&ts->ctx, formats, n, &ap);
+    va_end(ap);
+    return which;
+}
+
+
+/* =============================
+   my_sscanf / my_fscanf: one-call scans of a string or a FILE*
+   ============================= */
+
+int my_vsscanf(const char *str, const char *fmt, va_list ap) {
+    ScanCtx ctx;
+    ctx_init_mem(&ctx, str, strlen(str));
+    ThreadState *ts = thread_state();
+    if (ts) {
+        ctx.overflow_policy = ts->ctx.overflow_policy;
+        ctx.frac_policy = ts->ctx.frac_policy;
+        ctx.arena = &ts->ctx.own_arena;
+        ctx.interner = &ts->ctx.own_interner;
+    }
+    return my_vscanf_ctx(&ctx, fmt, ap);
+}
+
+int my_sscanf(const char *str, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int assigned = my_vsscanf(str, fmt, ap);
+    va_end(ap);
+    return assigned;
+}
+
+// Scans fp without keeping any state afterwards: whatever was read ahead is
+// handed back to fp before returning. Seekable streams are read in growing
+// blocks and the unused tail is returned with fseek; other streams are read
+// one byte per refill, so only what a conversion looked ahead and rewound
+// needs ungetc.
+int my_vfscanf(FILE *fp, const char *fmt, va_list ap) {
+    unsigned char buf[4096];
+    ScanCtx ctx;
+    ctx_init(&ctx, SRC_FILE, buf, sizeof buf);
+    ctx.fp = fp;
+    ctx.transient = 1;
+
+    int saved_errno = errno;
+    int seekable = (ftell(fp) >= 0);
+    errno = saved_errno;
+    ctx.chunk = seekable ? 256 : 1;
+    ThreadState *ts = thread_state();
+    if (ts) {
+        ctx.overflow_policy = ts->ctx.overflow_policy;
+        ctx.frac_policy = ts->ctx.frac_policy;
+        ctx.arena = &ts->ctx.own_arena;
+        ctx.interner = &ts->ctx.own_interner;
+    }
+
+    va_list cp;
+    va_copy(cp, ap);
+    int assigned = vscan(&ctx, fmt, &cp);
+    va_end(cp);
+
+    size_t unused = ctx.len - ctx.pos;
+    if (seekable) {
+        if (unused > 0) fseek(fp, -(long)unused, SEEK_CUR);
+    } else {
+        for (size_t i = ctx.len; i > ctx.pos; i--) ungetc(ctx.buf[i - 1], fp);
+    }
+    if (ctx.own_buf) free(ctx.buf);     // a long lookahead outgrew buf
+    return assigned;
+}
+
+int my_fscanf(FILE *fp, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int assigned = my_vfscanf(fp, fmt, ap);
+    va_end(ap);
+    return assigned;
+}
+
+
+/* =============================
+   Kernel entry points for my_scanf.hpp
+   The C++ header parses formats at compile time and calls these directly,
+   one call per op, with the Spec built as a constant.
+   ============================= */
+
+// Starts a call on ctx (or on this thread's stdin context when ctx is NULL).
+ScanCtx *my_scanf_k_begin(ScanCtx *ctx) {
+    if (!ctx) {
+        ThreadState *ts = thread_state();
+        if (!ts) return NULL;
+        ctx = &ts->ctx;
+    }
+    ctx_begin(ctx);
+    return ctx;
+}
+
+int my_scanf_k_lit(ScanCtx *ctx, const char *lit, int len) {
+    return match_lit(ctx, lit, len);
+}
+
+void my_scanf_k_ws(ScanCtx *ctx) {
+    skip_input_ws(ctx);
+}
+
+#if MY_SCANF_STATS
+#define KERNEL_ENTRY(name, fn) \
+    int name(ScanCtx *ctx, const Spec *sp, void *dst) { return stat_conv(ctx, fn, sp, dst); }
+#else
+#define KERNEL_ENTRY(name, fn) \
+    int name(ScanCtx *ctx, const Spec *sp, void *dst) { return fn(ctx, sp, dst); }
+#endif
+
+KERNEL_ENTRY(my_scanf_k_c, scan_c)
+KERNEL_ENTRY(my_scanf_k_s, scan_s)
+KERNEL_ENTRY(my_scanf_k_d, scan_d)
+KERNEL_ENTRY(my_scanf_k_x, scan_x)
+KERNEL_ENTRY(my_scanf_k_f, scan_f)
+KERNEL_ENTRY(my_scanf_k_q, scan_q)
+KERNEL_ENTRY(my_scanf_k_b, scan_b)
+KERNEL_ENTRY(my_scanf_k_r, scan_r)
+KERNEL_ENTRY(my_scanf_k_vs, scan_vs)
+KERNEL_ENTRY(my_scanf_k_vq, scan_vq)
+KERNEL_ENTRY(my_scanf_k_vr, scan_vr)
+KERNEL_ENTRY(my_scanf_k_set, scan_set)
+KERNEL_ENTRY(my_scanf_k_vset, scan_vset)
+KERNEL_ENTRY(my_scanf_k_is, scan_is)
+KERNEL_ENTRY(my_scanf_k_array, scan_array)
+KERNEL_ENTRY(my_scanf_k_D, scan_D)
+
+#undef KERNEL_ENTRY
+
+
+/* =============================
+   Parallel file scanning: my_scanf_file_parallel
+   The file is mapped and cut into chunks at newline boundaries; worker
+   threads scan the chunks with their own contexts, one record per line,
+   each line exactly as my_sscanf would scan it. Records reach the sink
+   in file order (delivered by the calling thread) or, with
+   MY_SCANF_UNORDERED, straight from the workers as they are scanned.
+   ============================= */
+
+#ifndef MY_SCANF_PAR_CHUNK
+#define MY_SCANF_PAR_CHUNK (4u << 20)   // bytes per chunk, rounded up to a line end
+#endif
+
+#define MY_SCANF_UNORDERED 1   // flag: call the sink from the workers, in any order
+
+// Where each assigned conversion of a record is stored. Array of structs:
+// field k of record i at (char*)base + i*rec_size + offsets[k]. Struct of
+// arrays (columns != NULL): field k at (char*)columns[k] + i*elem_size[k].
+// my_scanf_file_parallel keeps its records itself and only uses rec_size,
+// nfields and offsets; base and columns are for my_scanf_records.
+typedef struct {
+    size_t rec_size;        // bytes per record
+    int nfields;            // assigned conversions the layout has room for
+    const size_t *offsets;  // byte offset of the k-th assigned conversion's destination
+    void *base;
+    void *const *columns;
+    const size_t *elem_size;
+} ScanRecLayout;
+
+// Called once per line with the scanned record; offset is where the line
+// starts in the file and nassigned what my_sscanf would have returned.
+// Returning nonzero stops the scan. With MY_SCANF_UNORDERED it is called
+// from several threads at once.
+typedef int (*ScanRecordFn)(void *user, size_t offset, const void *rec, int nassigned);
+
+typedef struct {
+    size_t start, end;      // byte range; end is just past a '\n' or at EOF
+    int done;
+    // ordered mode: results waiting for delivery
+    char *recs;
+    int *nassigned;
+    size_t *offsets;
+    size_t count, cap;
+} ParChunk;
+
+typedef struct {
+    const char *data;
+    const ScanProg *prog;
+    const ScanRecLayout *layout;
+    ScanRecordFn sink;
+    void *user;
+    int unordered;
+    int overflow_policy;
+    int frac_policy;
+
+    ParChunk *chunks;
+    size_t nchunks;
+    size_t next_chunk;      // next chunk a worker may claim
+    size_t delivered;       // ordered: chunks already handed to the sink
+    size_t window;          // ordered: how many chunks workers may run ahead
+    size_t nrecords;        // unordered: records delivered
+    int stop;               // read by workers mid-chunk: only touched with __atomic_*
+    int err;                // errno to fail with, 0 if none
+
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+} ParJob;
+
+static int prog_nargs(const ScanProg *prog) {
+    int n = 0;
+    for (int i = 0; i < prog->nops; i++) {
+        if (prog->ops[i].kind == OP_CONV && !prog->ops[i].sp.suppress) n += (prog->ops[i].sp.count < 0) ? 2 : 1;
+    }
+    return n;
+}
+
+// whether prog has a %*,d array, whose capacity comes from its count argument
+static int prog_sized_array(const ScanProg *prog) {
+    for (int i = 0; i < prog->nops; i++) {
+        if (prog->ops[i].kind == OP_CONV && prog->ops[i].sp.count < 0) return 1;
+    }
+    return 0;
+}
+
+static char *par_slot(ParJob *job, ParChunk *ch) {
+    if (ch->count == ch->cap) {
+        size_t cap = ch->cap ? ch->cap * 2 : 1024;
+        char *recs = realloc(ch->recs, cap * job->layout->rec_size);
+        if (recs) ch->recs = recs;
+        int *na = realloc(ch->nassigned, cap * sizeof *na);
+        if (na) ch->nassigned = na;
+        size_t *off = realloc(ch->offsets, cap * sizeof *off);
+        if (off) ch->offsets = off;
+        if (!recs || !na || !off) return NULL;
+        ch->cap = cap;
+    }
+    return ch->recs + ch->count * job->layout->rec_size;
+}
+
+// Returns 0 when out of memory.
+static int par_scan_chunk(ParJob *job, ParChunk *ch, char *tmp) {
+    const char *p = job->data + ch->start;
+    const char *end = job->data + ch->end;
+    size_t rec_size = job->layout->rec_size;
+
+    while (p < end) {
+        if (__atomic_load_n(&job->stop, __ATOMIC_RELAXED)) return 1;
+
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = nl ? nl : end;
+
+        char *rec = job->unordered ? tmp : par_slot(job, ch);
+        if (!rec) return 0;
+        memset(rec, 0, rec_size);
+
+        ScanCtx ctx;
+        ctx_init_mem(&ctx, p, (size_t)(line_end - p));
+        ctx.overflow_policy = job->overflow_policy;
+        ctx.frac_policy = job->frac_policy;
+        ArgSrc args = { .rec = rec, .off = job->layout->offsets };
+        int n = exec_prog(&ctx, job->prog, &args);
+
+        size_t offset = (size_t)(p - job->data);
+        if (job->unordered) {
+            __atomic_add_fetch(&job->nrecords, 1, __ATOMIC_RELAXED);
+            if (job->sink(job->user, offset, rec, n)) {
+                __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+                return 1;
+            }
+        } else {
+            ch->nassigned[ch->count] = n;
+            ch->offsets[ch->count] = offset;
+            ch->count++;
+        }
+        p = nl ? nl + 1 : end;
+    }
+    return 1;
+}
+
+static void *par_worker(void *arg) {
+    ParJob *job = arg;
+    char *tmp = job->unordered ? malloc(job->layout->rec_size ? job->layout->rec_size : 1) : NULL;
+    if (job->unordered && !tmp) {
+        pthread_mutex_lock(&job->mu);
+        job->err = ENOMEM;
+        __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+        pthread_cond_broadcast(&job->cv);
+        pthread_mutex_unlock(&job->mu);
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&job->mu);
+        while (!__atomic_load_n(&job->stop, __ATOMIC_RELAXED) && !job->unordered &&
+               job->next_chunk < job->nchunks &&
+               job->next_chunk >= job->delivered + job->window) {
+            pthread_cond_wait(&job->cv, &job->mu);
+        }
+        if (__atomic_load_n(&job->stop, __ATOMIC_RELAXED) || job->next_chunk >= job->nchunks) {
+            pthread_mutex_unlock(&job->mu);
+            break;
+        }
+        ParChunk *ch = &job->chunks[job->next_chunk++];
+        pthread_mutex_unlock(&job->mu);
+
+        int ok = par_scan_chunk(job, ch, tmp);
+
+        pthread_mutex_lock(&job->mu);
+        ch->done = 1;
+        if (!ok) {
+            job->err = ENOMEM;
+            __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+        }
+        pthread_cond_broadcast(&job->cv);
+        pthread_mutex_unlock(&job->mu);
+    }
+    free(tmp);
+    return NULL;
+}
+
+static void par_free_results(ParChunk *ch) {
+    free(ch->recs);
+    free(ch->nassigned);
+    free(ch->offsets);
+    ch->recs = NULL;
+    ch->nassigned = NULL;
+    ch->offsets = NULL;
+}
+
+// Scans every line of the file at path with fmt on nthreads workers
+// (<= 0: one per online CPU). Returns the number of records handed to
+// sink, or -1 with errno set (bad format, layout too small, I/O, memory,
+// no worker thread could be created).
+// %*,d is refused (EINVAL): records start zeroed, so it would have no room.
+long my_scanf_file_parallel(const char *path, const char *fmt, int nthreads,
+                            const ScanRecLayout *layout, ScanRecordFn sink, void *user, int flags) {
+    ScanProg *prog = my_scanf_compile(fmt, NULL);
+    if (!prog) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (prog_nargs(prog) > layout->nfields || layout->columns || prog_sized_array(prog)) {
+        my_scanf_free(prog);
+        errno = EINVAL;
+        return -1;
+    }
+    ScanCtx *map = my_scanf_ctx_open_mmap(path);
+    if (!map) {
+        my_scanf_free(prog);
+        return -1;
+    }
+
+    if (nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0) nthreads = 1;
+
+    ParJob job;
+    memset(&job, 0, sizeof job);
+    job.data = (const char *)map->buf;
+    job.prog = prog;
+    job.layout = layout;
+    job.sink = sink;
+    job.user = user;
+    job.unordered = (flags & MY_SCANF_UNORDERED) != 0;
+    job.window = 2 * (size_t)nthreads;
+    ThreadState *ts = thread_state();
+    job.overflow_policy = ts ? ts->ctx.overflow_policy : MY_SCANF_OVERFLOW_FAIL;
+    job.frac_policy = ts ? ts->ctx.frac_policy : MY_SCANF_FRAC_REJECT;
+
+    // chunk boundaries: every chunk ends just past a newline
+    size_t size = map->len;
+    job.chunks = calloc(size / MY_SCANF_PAR_CHUNK + 1, sizeof *job.chunks);
+    if (!job.chunks) {
+        my_scanf_ctx_free(map);
+        my_scanf_free(prog);
+        return -1;
+    }
+    for (size_t pos = 0; pos < size; job.nchunks++) {
+        size_t end = pos + MY_SCANF_PAR_CHUNK;
+        if (end >= size) {
+            end = size;
+        } else {
+            const char *nl = memchr(job.data + end, '\n', size - end);
+            end = nl ? (size_t)(nl - job.data) + 1 : size;
+        }
+        job.chunks[job.nchunks].start = pos;
+        job.chunks[job.nchunks].end = end;
+        pos = end;
+    }
+
+    pthread_mutex_init(&job.mu, NULL);
+    pthread_cond_init(&job.cv, NULL);
+    pthread_t *th = malloc((size_t)nthreads * sizeof *th);
+    int started = 0, rc = ENOMEM;
+    if (th) {
+        while (started < nthreads && (rc = pthread_create(&th[started], NULL, par_worker, &job)) == 0) started++;
+    }
+    if (started == 0) job.err = rc;     // a partial start runs on fewer threads
+
+    long total = 0;
+    if (!job.unordered && started > 0) {
+        for (size_t k = 0; k < job.nchunks; k++) {
+            ParChunk *ch = &job.chunks[k];
+            pthread_mutex_lock(&job.mu);
+            while (!ch->done && !__atomic_load_n(&job.stop, __ATOMIC_RELAXED)) pthread_cond_wait(&job.cv, &job.mu);
+            int go = ch->done && !job.err;
+            pthread_mutex_unlock(&job.mu);
+            if (!go) break;
+
+            int stop = 0;
+            for (size_t i = 0; i < ch->count && !stop; i++) {
+                stop = sink(user, ch->offsets[i], ch->recs + i * layout->rec_size, ch->nassigned[i]);
+                total++;
+            }
+            par_free_results(ch);
+
+            pthread_mutex_lock(&job.mu);
+            job.delivered = k + 1;
+            if (stop) __atomic_store_n(&job.stop, 1, __ATOMIC_RELAXED);
+            pthread_cond_broadcast(&job.cv);
+            pthread_mutex_unlock(&job.mu);
+            if (stop) break;
+        }
+        pthread_mutex_lock(&job.mu);
+        __atomic_store_n(&job.stop, 1, __ATOMIC_RELAXED);
+        pthread_cond_broadcast(&job.cv);
+        pthread_mutex_unlock(&job.mu);
+    }
+
+    for (int t = 0; t < started; t++) pthread_join(th[t], NULL);
+    if (job.unordered) total = (long)job.nrecords;
+
+    for (size_t k = 0; k < job.nchunks; k++) par_free_results(&job.chunks[k]);
+    free(job.chunks);
+    free(th);
+    pthread_cond_destroy(&job.cv);
+    pthread_mutex_destroy(&job.mu);
+    my_scanf_ctx_free(map);
+    my_scanf_free(prog);
+
+    if (job.err) {
+        errno = job.err;
+        return -1;
+    }
+    return total;
+}
+
+
+/* =============================
+   Batch records: my_scanf_records
+   Runs one format n times in a row, storing record i straight into an
+   array of structs or into one array per field, without varargs.
+   ============================= */
+
+// How a batch ended.
+typedef struct {
+    size_t record;          // index of the first incomplete record (== n if all completed)
+    int field;              // fields assigned in that record, i.e. the one that failed
+    int eof;                // input was exhausted (a clean end when field == 0)
+} ScanBatchStatus;
+
+// Cached program for fmt, or a fresh one in *owned (caller frees it).
+// NULL if fmt has a bad spec or memory ran out.
+static const ScanProg *batch_prog(const char *fmt, ScanProg **owned) {
+    *owned = NULL;
+#if MY_SCANF_FMT_CACHE > 0
+    ThreadState *ts = thread_state();
+    if (ts) {
+        const ScanProg *prog = fmt_cache_get(ts->cache, fmt);
+        if (prog && prog->nops > 0 && prog->ops[prog->nops - 1].kind == OP_FAIL) return NULL;
+        if (prog) return prog;
+    }
+#endif
+    *owned = my_scanf_compile(fmt, NULL);
+    return *owned;
 }
 
+static int ctx_at_eof(ScanCtx *ctx) {
+    int c = nextch(ctx);
+    if (c == EOF) return 1;
+    unreadch(ctx, c);
+    return 0;
+}
 
-// %r: reads the remainder of the current line (until newline), excluding the newline
-static int scan_r(const Spec *sp, va_list *ap) {
-    char *out = NULL;
-    if (!sp->suppress) out = va_arg(*ap, char*);
-
-    int limit = sp->width;
-    int i = 0;
-
-    int c = nextch();
-    if (c == EOF) return 0;
+// Scans up to n records from ctx, laid out as described by layout (see
+// ScanRecLayout); returns how many were complete (the whole format matched
+// and consumed input), or -1 with errno = EINVAL for a bad format or a
+// layout with too few fields. status may be NULL.
+long my_scanf_records_ctx(ScanCtx *ctx, const char *fmt, size_t n,
+                          const ScanRecLayout *layout, ScanBatchStatus *status) {
+    ScanProg *owned;
+    const ScanProg *prog = batch_prog(fmt, &owned);
+    int nargs = prog ? prog_nargs(prog) : 0;
+    if (!prog || nargs > layout->nfields) {
+        my_scanf_free(owned);
+        errno = EINVAL;
+        return -1;
+    }
 
-    while (c != EOF && c != '\n') {
-        if (limit == 0 || i < limit) {
-            if (!sp->suppress) out[i] = (char)c;
-            i++;
+    ctx_begin(ctx);
+    ArgSrc args = { .off = layout->offsets,
+                    .cols = (char *const *)layout->columns,
+                    .col_size = layout->elem_size };
+    size_t i;
+    int got = nargs;
+    for (i = 0; i < n; i++) {
+        args.rec = (char *)layout->base + i * layout->rec_size;
+        args.index = i;
+        args.next = 0;
+        // a record that fails or reads nothing (a format of only
+        // suppressed conversions at the end of input) ends the batch
+        uint64_t from = ctx->base + ctx->pos;
+        int k;
+        got = 0;
+        for (k = 0; k < prog->nops; k++) {
+            if (!run_op(ctx, &prog->ops[k], &args, &got)) break;
         }
-        c = nextch();
+        if (k < prog->nops || ctx->base + ctx->pos == from) break;
     }
 
-    if (!sp->suppress) {
-        int term = (limit == 0) ? i : (i < limit ? i : limit);
-        out[term] = '\0';
+    if (status) {
+        status->record = i;
+        status->field = (i < n) ? got : 0;
+        // a failed record has already looked at the next byte; after n
+        // complete ones, reading it could block on a pipe that stays open
+        status->eof = (i < n) ? ctx_at_eof(ctx) : (ctx->eof && ctx->pos == ctx->len);
     }
+    my_scanf_free(owned);
+    return (long)i;
+}
 
-    return 1;
+long my_scanf_records(const char *fmt, size_t n, const ScanRecLayout *layout, ScanBatchStatus *status) {
+    ThreadState *ts = thread_state();
+    if (!ts) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return my_scanf_records_ctx(&ts->ctx, fmt, n, layout, status);
 }
 
 
 /* =============================
-   my_scanf: dispatcher
-   Returns number of successful assignments.
+   Push scanning: my_scanf_feed / my_scanf_next
+   For event loops: the caller feeds whatever bytes arrived and asks for
+   the next record. When the input runs out in the middle of a record the
+   scan is undone (cursor rewound to a mark, %m strings) and tried again from the
+   record's first byte after the next feed, so no partial-token state has
+   to be kept between calls.
    ============================= */
 
-int my_scanf(const char *fmt, ...) {
-va_list ap;
-va_start(ap, fmt);
-
-int assigned = 0;
-const char *p = fmt;
-
-while (*p) {
-    if (*p == '%') {
-        p++; // move past '%'
-
-        if (*p == '%') {
-            int c = nextch();
-            if (c != '%') {
-                if (c != EOF) unreadch(c);
-                break;
-            }
-            p++;
-            continue;
-        }
-
-        Spec sp;
-        if (!parse_spec(&p, &sp)) break;
-
-        int ok = 0;
-        switch (sp.conv) {
-            case 'c': ok = scan_c(&sp, &ap); break;
-            case 's': ok = scan_s(&sp, &ap); break;
-            case 'd': ok = scan_d(&sp, &ap); break;
-            case 'x': ok = scan_x(&sp, &ap); break;
-            case 'f': {
-                void *dst;
-                if (sp.len == LEN_NONE) dst = va_arg(ap, float*);
-                else if (sp.len == LEN_L) dst = va_arg(ap, double*);
-                else if (sp.len == LEN_CAP_L) dst = va_arg(ap, long double*);
-                else { ok = 0; break; }
-                ok = scan_f(&sp, dst);
-                break;
-            }
-            case 'q': ok = scan_q(&sp, &ap); break;
-            case 'b': ok = scan_b(&sp, &ap); break;
-            case 'r': ok = scan_r(&sp, &ap); break;
+#define MY_SCANF_RECORD     1   // a record was scanned
+#define MY_SCANF_NEED_MORE  0   // input ran out mid-record: feed more, then call again
+#define MY_SCANF_MISMATCH (-1)  // input does not match the format
+#define MY_SCANF_END      (-2)  // end of input was fed and only whitespace is left
 
+// New context for my_scanf_feed / my_scanf_next; NULL if out of memory.
+ScanCtx *my_scanf_ctx_new_push(void) {
+    return ctx_new_buffered(SRC_PUSH);
+}
 
-            default:  ok = 0; break;
+// Appends len bytes of input; len == 0 marks the end of input (as a
+// read() of 0 would). Views from earlier calls become invalid.
+// Returns 0, or -1 with errno = ENOMEM.
+int my_scanf_feed(ScanCtx *ctx, const void *data, size_t len) {
+    if (len == 0) {
+        ctx->eof = 1;
+        return 0;
+    }
+    ctx->nviews = 0;
+
+    if (ctx->cap - ctx->len < len) {
+        // drop what has been scanned
+        size_t from = ctx_keep_from(ctx);
+        memmove(ctx->buf, ctx->buf + from, ctx->len - from);
+        ctx->base += from;
+        ctx->pos -= from;
+        ctx->len -= from;
+    }
+    while (ctx->cap - ctx->len < len) {
+        if (!ctx_grow(ctx)) {
+            errno = ENOMEM;
+            return -1;
         }
+    }
+    memcpy(ctx->buf + ctx->len, data, len);
+    ctx->len += len;
+    return 0;
+}
 
-        if (!ok) break;
-        if (!sp.suppress) assigned++;
-
-    } else if (isspace((unsigned char)*p)) {
-        while (*p && isspace((unsigned char)*p)) p++;
-        skip_input_ws();
+// only whitespace left after the end of input was fed
+static int push_at_end(ScanCtx *ctx) {
+    if (!ctx->eof) return 0;
+    size_t pos = ctx->pos;
+    skip_input_ws(ctx);
+    int end = ctx_at_eof(ctx);
+    ctx->pos = pos;
+    return end;
+}
 
-    } else {
-        int c = nextch();
-        if (c != (unsigned char)*p) {
-            if (c != EOF) unreadch(c);
-            break;
-        }
-        p++;
+// Scans the next record with fmt from the bytes fed so far; returns one
+// of MY_SCANF_RECORD / _NEED_MORE / _MISMATCH / _END. After a mismatch
+// the input stays where the mismatch was found, as with my_scanf. A bad
+// format is a mismatch with errno = EINVAL.
+int my_scanf_next(ScanCtx *ctx, const char *fmt, ...) {
+    ScanProg *owned;
+    const ScanProg *prog = batch_prog(fmt, &owned);
+    if (!prog) {
+        errno = EINVAL;
+        return MY_SCANF_MISMATCH;
+    }
+    if (push_at_end(ctx)) {
+        my_scanf_free(owned);
+        return MY_SCANF_END;
     }
-}
 
-va_end(ap);
-return assigned;
+    // everything needed to undo the attempt
+    ctx_begin(ctx);
+    ScanMark start = ctx_mark(ctx);
+    ArenaMark am = { NULL, 0 };
+    if (ctx->arena) am = arena_mark(ctx->arena);
+
+    ctx->starved = 0;
+    va_list ap;
+    va_start(ap, fmt);
+    ArgSrc args = { .ap = &ap };
+    int assigned = 0, i;
+    for (i = 0; i < prog->nops; i++) {
+        if (!run_op(ctx, &prog->ops[i], &args, &assigned)) break;
+    }
+    va_end(ap);
+    int done = (i == prog->nops);
+    my_scanf_free(owned);   // may be prog itself
+
+    ctx_release(ctx, start);
+    if (ctx->starved) {
+        ctx_rewind(ctx, start);
+        if (ctx->arena) arena_rewind(ctx->arena, am);
+        ctx->nviews = 0;
+        return MY_SCANF_NEED_MORE;
+    }
+    return done ? MY_SCANF_RECORD : MY_SCANF_MISMATCH;
 }
 
 
 /* =============================
    Tests (RUN_TESTS)
+   Left out with -DMY_SCANF_NO_MAIN, to link this file into a program.
    ============================= */
+#ifndef MY_SCANF_NO_MAIN
 #include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
 #include <math.h>
+#include <sys/socket.h>
 
 static void reset_unread_buffer(void) {
-    ubuf_len = 0;
+    ScanCtx *ctx = &thread_state()->ctx;
+    ctx->pos = 0;
+    ctx->len = 0;
+    ctx->eof = 0;
 }
 
 static int tests_run = 0;
@@ -750,6 +4919,7 @@ static void set_stdin_to_string(const char *input) {
     if (!freopen(fname, "rb", stdin)) {
         perror("freopen stdin");
     }
+    reset_unread_buffer();  // freopen drops buffered input; so do we
 }
 
 /* ---------- tests ---------- */
@@ -852,8 +5022,1695 @@ static void test_custom_q_b_r(void) {
     CHECK_STR("%*r%r reads second line", line, "second line to read");
 }
 
+static void test_refill_boundary(void) {
+    /* a token split across two read() blocks */
+    size_t pad = INBUF_SIZE - 3;
+    char *big = malloc(pad + 32);
+    memset(big, ' ', pad);
+    strcpy(big + pad, "12345 3x");
+    set_stdin_to_string(big);
+    int d = 0; unsigned int x = 0; char ch = '\0';
+    int n = my_scanf("%d %x%c", &d, &x, &ch);
+    CHECK_INT("refill: n", n, 3);
+    CHECK_INT("refill: %d straddles block", d, 12345);
+    CHECK_UINT("refill: %x", x, 3u);
+    CHECK_INT("refill: leftover for %c", (int)ch, (int)'x');
+
+    /* lookahead given back right after a refill */
+    pad = INBUF_SIZE - 1;
+    memset(big, ' ', pad);
+    strcpy(big + pad, "7x");
+    set_stdin_to_string(big);
+    x = 0; ch = '\0';
+    n = my_scanf("%x%c", &x, &ch);
+    CHECK_INT("refill unread: n", n, 2);
+    CHECK_UINT("refill unread: x", x, 7u);
+    CHECK_INT("refill unread: leftover", (int)ch, (int)'x');
+
+    /* %s token copied in two blocks */
+    pad = INBUF_SIZE - 4;
+    memset(big, ' ', pad);
+    strcpy(big + pad, "abcdefgh ij");
+    set_stdin_to_string(big);
+    char s1[16] = {0}, s2[16] = {0};
+    n = my_scanf("%s%s", s1, s2);
+    CHECK_INT("refill %s: n", n, 2);
+    CHECK_STR("refill %s: straddling token", s1, "abcdefgh");
+    CHECK_STR("refill %s: next token", s2, "ij");
+    free(big);
+}
+
+static void test_compile_exec(void) {
+    const char *err = NULL;
+    ScanProg *prog = my_scanf_compile(" id=%d%%, %2s %*x|%lf", &err);
+    CHECK_INT("compile: ok", prog != NULL, 1);
+
+    set_stdin_to_string("id=7%, ab ff|2.5\n id=8%, xy 0|1");
+    int id = 0; char s[8] = {0}; double v = 0.0;
+    int n = my_scanf_exec(prog, &id, s, &v);
+    CHECK_INT("exec: n", n, 3);
+    CHECK_INT("exec: id", id, 7);
+    CHECK_STR("exec: %2s", s, "ab");
+    CHECK_DBL("exec: %lf", v, 2.5, 1e-12);
+
+    n = my_scanf_exec(prog, &id, s, &v);
+    CHECK_INT("exec again: n", n, 3);
+    CHECK_INT("exec again: id", id, 8);
+    CHECK_STR("exec again: %2s", s, "xy");
+    CHECK_DBL("exec again: %lf", v, 1.0, 1e-12);
+    my_scanf_free(prog);
+
+    const char *bad = "%d %y";
+    prog = my_scanf_compile(bad, &err);
+    CHECK_INT("compile: unknown conversion rejected", prog == NULL, 1);
+    CHECK_INT("compile: error position", (int)(err - bad), 3);
+    set_stdin_to_string("4 5");
+    CHECK_INT("my_scanf still assigns up to the bad spec", my_scanf(bad, &id), 1);
+    CHECK_INT("my_scanf bad spec: id", id, 4);
+
+    bad = "%d %";
+    prog = my_scanf_compile(bad, &err);
+    CHECK_INT("compile: dangling % rejected", prog == NULL, 1);
+    CHECK_INT("compile: dangling position", (int)(err - bad), 3);
+
+    /* same buffer, new contents: the format cache must not return a stale program */
+    char fmt[16];
+    strcpy(fmt, "%d");
+    set_stdin_to_string("5 abc");
+    int a = 0;
+    n = my_scanf(fmt, &a);
+    strcpy(fmt, "%s");
+    char t[8] = {0};
+    n += my_scanf(fmt, t);
+    CHECK_INT("cache: reused buffer n", n, 2);
+    CHECK_STR("cache: reused buffer recompiled", t, "abc");
+}
+
+static void test_ws_kernels(void) {
+    /* every kernel must agree with the scalar loop at every offset; the
+       SSE2 ones are also called directly, since with AVX2 the dispatched
+       kernel only reaches them for the tail */
+    unsigned char buf[100];
+    const char ws[] = " \t\n\v\f\r";
+    const char qesc[] = "\"\\";
+#ifdef HAVE_X86_KERNELS
+    int avx2 = __builtin_cpu_supports("avx2");
+#endif
+    int bad = 0;
+    for (int k = 0; k < 100; k++) {
+        for (int j = 0; j < 100; j++) buf[j] = (unsigned char)('a' + j % 26);
+        buf[k] = (unsigned char)ws[k % 6];
+        for (int start = 0; start < 100; start++) {
+            const unsigned char *want = find_ws_scalar(buf + start, buf + 100);
+            if (find_ws(buf + start, buf + 100) != want) bad++;
+#ifdef HAVE_X86_KERNELS
+            if (find_ws_sse2(buf + start, buf + 100) != want) bad++;
+            if (avx2 && find_ws_avx2(buf + start, buf + 100) != want) bad++;
+#endif
+        }
+        for (int j = 0; j < 100; j++) buf[j] = (unsigned char)ws[j % 6];
+        buf[k] = (unsigned char)(k == 50 ? 0x80 : 'x');
+        for (int start = 0; start < 100; start++) {
+            const unsigned char *want = find_nonws_scalar(buf + start, buf + 100);
+            if (find_nonws(buf + start, buf + 100) != want) bad++;
+#ifdef HAVE_X86_KERNELS
+            if (find_nonws_sse2(buf + start, buf + 100) != want) bad++;
+            if (avx2 && find_nonws_avx2(buf + start, buf + 100) != want) bad++;
+#endif
+        }
+        for (int j = 0; j < 100; j++) buf[j] = (unsigned char)(j % 3 ? 'a' + j % 26 : 0x80 | j);
+        buf[k] = (unsigned char)qesc[k % 2];
+        for (int start = 0; start < 100; start++) {
+            const unsigned char *want = find_qesc_scalar(buf + start, buf + 100);
+            if (find_qesc(buf + start, buf + 100) != want) bad++;
+#ifdef HAVE_X86_KERNELS
+            if (find_qesc_sse2(buf + start, buf + 100) != want) bad++;
+            if (avx2 && find_qesc_avx2(buf + start, buf + 100) != want) bad++;
+#endif
+        }
+    }
+    CHECK_INT("ws and %q kernels match scalar", bad, 0);
+
+    /* long tokens, mixed whitespace, width cut in the middle of a vector */
+    char in_s[256], a[80] = {0}, b[80] = {0}, q[80] = {0};
+    memset(a, 'A', 70);
+    memset(b, 'b', 45);
+    snprintf(in_s, sizeof in_s, " \t\v\f\r\n%s\n\n%s\t%s", a, b, "unquoted_token_longer_than_32_bytes_xx");
+    set_stdin_to_string(in_s);
+    char s1[80] = {0}, s2[80] = {0};
+    int n = my_scanf("%s %40s%s %q", s1, s2, b, q);
+    CHECK_INT("long tokens: n", n, 4);
+    CHECK_INT("long tokens: %s length", (int)strlen(s1), 70);
+    CHECK_INT("long tokens: %40s length", (int)strlen(s2), 40);
+    CHECK_STR("long tokens: rest after width", b, "bbbbb");
+    CHECK_STR("long tokens: unquoted %q", q, "unquoted_token_longer_than_32_bytes_xx");
+}
+
+static void test_scansets(void) {
+    /* every kernel must agree with the scalar loop, for all 256 byte values */
+    unsigned char set[32], buf[300];
+    unsigned seed = 12345;
+    int bad = 0;
+    for (int k = 0; k < 200; k++) {
+        for (int i = 0; i < 32; i++) set[i] = (unsigned char)((seed = seed * 1103515245u + 12345u) >> 16);
+        for (int c = 0; c < 256; c++) buf[c] = (unsigned char)c;
+        for (int c = 256; c < 300; c++) buf[c] = buf[c - 256];
+        int b = k % 256;
+        set[(b & 15) | (b >> 7) << 4] |= (unsigned char)(1u << ((b >> 4) & 7));
+        memset(buf + 100, b, 100);      // a long run of one member
+        for (int start = 0; start < 300; start += 13) {
+            const unsigned char *want = find_notin_scalar(set, buf + start, buf + 300);
+            if (find_notin(set, buf + start, buf + 300) != want) bad++;
+#ifdef HAVE_X86_KERNELS
+            if (__builtin_cpu_supports("ssse3") && find_notin_ssse3(set, buf + start, buf + 300) != want) bad++;
+#endif
+        }
+    }
+    CHECK_INT("scanset kernels match scalar", bad, 0);
+
+    char a[64] = {0}, b[64] = {0}, c[64] = {0};
+    int n = my_sscanf("key_1=some value,next", "%[A-Za-z0-9_]=%[^,],%s", a, b, c);
+    CHECK_INT("scanset: n", n, 3);
+    CHECK_STR("scanset: range", a, "key_1");
+    CHECK_STR("scanset: negated keeps spaces", b, "some value");
+    CHECK_STR("scanset: rest", c, "next");
+
+    n = my_sscanf("]-a]x", "%[]a-]%c", a, c);
+    CHECK_INT("scanset: leading ] and trailing -", n == 2 && strcmp(a, "]-a]") == 0 && c[0] == 'x', 1);
+    n = my_sscanf(" abc", "%[a-z]", a);
+    CHECK_INT("scanset: no whitespace skip", n, 0);
+    n = my_sscanf("abcdef", "%3[a-z]%s", a, b);
+    CHECK_INT("scanset: width", n == 2 && strcmp(a, "abc") == 0 && strcmp(b, "def") == 0, 1);
+    n = my_sscanf("x\xe9\xff,", "%[^,]", a);
+    CHECK_INT("scanset: high bytes", n == 1 && strcmp(a, "x\xe9\xff") == 0, 1);
+    const char *err;
+    CHECK_INT("scanset: missing ] rejected", my_scanf_compile("%[abc", &err) == NULL, 1);
+
+    /* long runs across refills, and the %v / %m / %* forms */
+    char line[3000];
+    memset(line, 'z', 2500);
+    strcpy(line + 2500, ";tail");
+    set_stdin_to_string(line);
+    char *big = NULL;
+    n = my_scanf("%m[a-z];%*[a-z]", &big);
+    CHECK_INT("scanset: %m long run", n == 1 && big && strlen(big) == 2500, 1);
+    ScanView v;
+    n = my_sscanf("name: value", "%v[a-z]", &v);
+    CHECK_INT("scanset: view", n == 1 && v.len == 4 && memcmp(v.ptr, "name", 4) == 0, 1);
+}
+
+static void test_r_lines(void) {
+    /* a line much longer than the read buffer, then more lines after it */
+    size_t big = 300000;
+    char *in = malloc(big + 64);
+    memset(in, 'L', big);
+    strcpy(in + big, "\r\nsecond\r\n\nthird");
+    set_stdin_to_string(in);
+    char *line = NULL, s2[16] = {0}, s3[16] = {0}, s4[16] = {0};
+    int n = my_scanf("%mR", &line);
+    CHECK_INT("%mR long line", n == 1 && line && strlen(line) == big && line[big - 1] == 'L', 1);
+    n = my_scanf("%r%R%r", s2, s3, s4);
+    CHECK_INT("%r after long line: n", n, 3);
+    CHECK_STR("%r keeps the \\r", s2, "second\r");
+    CHECK_STR("%R on an empty line", s3, "");
+    CHECK_STR("%r last line without newline", s4, "third");
+    CHECK_INT("%r at end of input fails", my_scanf("%r", s4), 0);
+
+    /* %*r skips; width keeps a prefix and still consumes the line */
+    memcpy(in + big, "\nx\n", 4);
+    in[big + 4] = '\0';
+    set_stdin_to_string(in);
+    n = my_scanf("%*r%c", s2);
+    CHECK_INT("%*r skips the line", n == 1 && s2[0] == 'x', 1);
+    n = my_sscanf("abcdef\r\nnext", "%4R%s", s2, s3);
+    CHECK_INT("%4R", n == 2 && strcmp(s2, "abcd") == 0 && strcmp(s3, "next") == 0, 1);
+    n = my_sscanf("ab\r\n", "%3R", s2);
+    CHECK_INT("%3R drops the \\r only if it fit", n == 1 && strcmp(s2, "ab") == 0, 1);
+
+    ScanView v;
+    n = my_sscanf("key value\r\n", "%*s %vR", &v);
+    CHECK_INT("%vR", n == 1 && v.len == 5 && memcmp(v.ptr, "value", 5) == 0, 1);
+
+    /* the view of a long line survives refills on a buffered context */
+    set_stdin_to_string(in);
+    ScanCtx *ctx = my_scanf_ctx_new(fileno(stdin));
+    n = my_scanf_ctx(ctx, "%vr", &v);
+    CHECK_INT("%vr long line", n == 1 && v.len == big && v.ptr[0] == 'L' && v.ptr[big - 1] == 'L', 1);
+    my_scanf_ctx_free(ctx);
+    free(in);
+}
+
+static void test_lookahead(void) {
+    /* "nan(" followed by thousands of characters and no ')': the whole
+       lookahead is given back, through a stream read one byte at a time */
+    size_t len = 6000;
+    char *in = malloc(len + 200), *word = malloc(len + 200);
+    memcpy(in, "nan(", 4);
+    memset(in + 4, 'a', len);
+    strcpy(in + 4 + len, "! nan(");
+    memset(in + len + 10, 'b', 100);
+    strcpy(in + len + 110, ") 5");
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    CHECK_INT("lookahead: pipe write", (int)write(fds[1], in, strlen(in)), (int)strlen(in));
+    close(fds[1]);
+    FILE *rf = fdopen(fds[0], "r");
+    double v = 0, w = 0;
+    int k = 0;
+    int n = my_fscanf(rf, "%lf%s %lf %d", &v, word, &w, &k);
+    CHECK_INT("lookahead: n", n, 4);
+    CHECK_INT("lookahead: nan without ')'", isnan(v) != 0, 1);
+    CHECK_INT("lookahead: rewound past 16 chars", strlen(word) == len + 2 && word[0] == '(', 1);
+    CHECK_INT("lookahead: long nan(...) consumed", isnan(w) && k == 5, 1);
+    fclose(rf);
+
+    /* %2x on "0x": no digit fits, so both characters are given back */
+    unsigned x = 1;
+    char rest[8] = {0};
+    ScanCtx *ctx = my_scanf_ctx_new_mem("0xg", 3);
+    n = my_scanf_ctx(ctx, "%2x", &x);
+    n += my_scanf_ctx(ctx, "%s", rest);
+    CHECK_INT("lookahead: 0x rewound", n == 1 && x == 1 && strcmp(rest, "0xg") == 0, 1);
+    my_scanf_ctx_free(ctx);
+    free(in);
+    free(word);
+}
+
+static void test_q_escapes(void) {
+    /* the kernel agrees with the scalar loop wherever the stop byte is */
+    unsigned char buf[200];
+    int bad = 0;
+    for (int k = 0; k < 200; k++) {
+        memset(buf, 'a', sizeof buf);
+        buf[k] = (k & 1) ? '"' : '\\';
+        for (int start = 0; start < 200; start += 9) {
+            if (find_qesc(buf + start, buf + 200) != find_qesc_scalar(buf + start, buf + 200)) bad++;
+        }
+    }
+    CHECK_INT("%q kernel matches scalar", bad, 0);
+
+    char a[64] = {0}, b[64] = {0}, c[64] = {0};
+    int n = my_sscanf("\"say \\\"hi\\\"\" \"a\\\\b\\n\\t\\/\" next",
+                      "%q %q %s", a, b, c);
+    CHECK_INT("%q escapes: n", n, 3);
+    CHECK_STR("%q escaped quotes", a, "say \"hi\"");
+    CHECK_STR("%q \\\\ \\n \\t \\/", b, "a\\b\n\t/");
+    CHECK_STR("%q then the rest", c, "next");
+
+    n = my_sscanf("\"\\u00e9\\u20AC\\ud83d\\ude00\\udc00\\ud800x\"", "%q", a);
+    CHECK_STR("%q \\u to UTF-8", a, "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xef\xbf\xbd\xef\xbf\xbdx");
+    n = my_sscanf("\"\\u12g \\q\"", "%q", a);
+    CHECK_STR("%q bad escapes kept as written", a, "\\u12g \\q");
+    n = my_sscanf("\"ab\\\"cd\\u00e9\" z", "%4q %s", a, b);
+    CHECK_INT("%4q stops storing, still consumes", n == 2 && strcmp(a, "ab\"c") == 0 && strcmp(b, "z") == 0, 1);
+    n = my_sscanf("\"ab\\u00e9c\" z", "%3q %s", a, b);
+    CHECK_INT("%3q: nothing stored after an escape that didn't fit", n == 2 && strcmp(a, "ab") == 0 && strcmp(b, "z") == 0, 1);
+    n = my_sscanf("\"unterminated \\\"", "%q", a);
+    CHECK_INT("%q escaped quote does not close", n, 0);
+
+    ScanView v;
+    n = my_sscanf("\"x\\\"y\" k", "%vq %s", &v, b);
+    CHECK_INT("%vq spans escapes raw", n == 2 && v.len == 4 && memcmp(v.ptr, "x\\\"y", 4) == 0, 1);
+
+    /* long strings with escapes, read through a stream one byte at a time */
+    size_t len = 4950;    /* 49 "\\n" escapes */
+    char *in = malloc(len + 16), *out = malloc(len + 16);
+    in[0] = '"';
+    for (size_t i = 1; i <= len; i++) in[i] = (i % 100 == 0) ? '\\' : (i % 100 == 1) ? 'n' : 'q';
+    strcpy(in + len + 1, "\" 42");
+    int fds[2];
+    if (pipe(fds) == 0) {
+        CHECK_INT("%q pipe write", (int)write(fds[1], in, strlen(in)), (int)strlen(in));
+        close(fds[1]);
+        FILE *rf = fdopen(fds[0], "r");
+        int k = 0;
+        n = my_fscanf(rf, "%q %d", out, &k);
+        CHECK_INT("%q long string: n", n == 2 && k == 42, 1);
+        CHECK_INT("%q long string: escapes decoded", strlen(out) == len - 49 && out[99] == '\n', 1);
+        fclose(rf);
+    }
+    free(in);
+    free(out);
+}
+
+static void test_suppress_skip(void) {
+    /* %*d, %*x, %*b, %*f and %*q take the skip paths; they must match the
+       same input and leave the cursor in the same place as the full
+       conversion, overflow included */
+    static const char *const fmts[][2] = {
+        { "%lld", "%*lld" }, { "%3lld", "%*3lld" }, { "%hhd", "%*hhd" }, { "%d", "%*d" },
+        { "%llx", "%*llx" }, { "%4llx", "%*4llx" }, { "%hx", "%*hx" },
+        { "%llb", "%*llb" }, { "%2llb", "%*2llb" }, { "%hhb", "%*hhb" },
+        { "%lf", "%*f" }, { "%5lf", "%*5f" }, { "%q", "%*q" }, { "%6q", "%*6q" },
+        { "%.2D", "%*.2D" },
+    };
+    static const char alpha[] = "0123456789abcdefxXpP+-.eEinfINFty\"\\u \n";
+    unsigned seed = 2024;
+    int bad = 0, diffs = 0;
+    for (int trial = 0; trial < 20000; trial++) {
+        char in[40];
+        int len = (int)((seed = seed * 1103515245u + 12345u) >> 16) % 32;
+        // every fourth input is a long digit run, mostly out of range
+        int digits = (trial % 4 == 0);
+        for (int i = 0; i < len; i++) {
+            unsigned r = (seed = seed * 1103515245u + 12345u) >> 16;
+            in[i] = digits ? (char)('0' + r % 10) : alpha[r % (sizeof alpha - 1)];
+        }
+        in[len] = '\0';
+        for (size_t k = 0; k < sizeof fmts / sizeof fmts[0]; k++) {
+            union { long long i; double f; char s[128]; } v;
+            ScanCtx *full = my_scanf_ctx_new_mem(in, (size_t)len);
+            ScanCtx *skip = my_scanf_ctx_new_mem(in, (size_t)len);
+            Spec fs, ss;
+            const char *fp = fmts[k][0] + 1, *sp = fmts[k][1] + 1;
+            parse_spec(&fp, &fs);
+            parse_spec(&sp, &ss);
+            ctx_begin(full);
+            ctx_begin(skip);
+            int a = conv_fn(&fs)(full, &fs, &v);
+            int b = conv_fn(&ss)(skip, &ss, NULL);
+            if (a != b || full->pos != skip->pos) {
+                if (bad++ < 5) printf("  %s vs %s on [%s]: %d/%zu %d/%zu\n", fmts[k][0], fmts[k][1],
+                                      in, a, full->pos, b, skip->pos);
+            }
+            diffs += (a == 1);
+            my_scanf_ctx_free(full);
+            my_scanf_ctx_free(skip);
+        }
+    }
+    CHECK_INT("%* skip paths agree with full conversions", bad, 0);
+    CHECK_INT("%* differential covers matches", diffs > 10000, 1);
+
+    int x;
+    CHECK_INT("%*d rejects an overflowing value", my_sscanf("99999999999 7", "%*d %d", &x), 0);
+    CHECK_INT("%*hhx rejects an overflowing value", my_sscanf("fff 7", "%*hhx %d", &x), 0);
+    CHECK_INT("%*d takes a value in range", my_sscanf("2147483647 7", "%*d %d", &x), 1);
+    CHECK_INT("%*d then %d", x, 7);
+}
+
+static void test_alt(void) {
+    /* the shared prefixes (" GE", " %d") are matched once */
+    static const char *const fmts[] = { " GET %s %d", " GEM %d", " PUT %s", " %d,%d" };
+    set_stdin_to_string("GEM 7\nGET /a 200\n3,4\nPUT /b\nDEL x\n");
+    char s[32] = {0};
+    int a = 0, b = 0;
+    int w = my_scanf_alt(fmts, 4, &a, &b);
+    CHECK_INT("alt: GEM", w == 1 && a == 7, 1);
+    w = my_scanf_alt(fmts, 4, s, &a);
+    CHECK_INT("alt: GET", w == 0 && strcmp(s, "/a") == 0 && a == 200, 1);
+    w = my_scanf_alt(fmts, 4, &a, &b);
+    CHECK_INT("alt: %d,%d", w == 3 && a == 3 && b == 4, 1);
+    w = my_scanf_alt(fmts, 4, s);
+    CHECK_INT("alt: PUT", w == 2 && strcmp(s, "/b") == 0, 1);
+    w = my_scanf_alt(fmts, 4, s, &a);
+    CHECK_INT("alt: no match", w, -1);
+    int n = my_scanf("%s", s);
+    CHECK_INT("alt: no match consumed nothing", n == 1 && strcmp(s, "DEL") == 0, 1);
+
+    const char *err;
+    static const char *const bad[] = { "%d", "%y" };
+    CHECK_INT("alt: bad spec rejected", my_scanf_alt_compile(bad, 2, &err) == NULL && err == bad[1], 1);
+    static const char *const sized[] = { "%d", "%*,d" };
+    CHECK_INT("alt: argument-sized array rejected", my_scanf_alt_compile(sized, 2, &err) == NULL && err == sized[1], 1);
+
+    /* list order wins, even when a later format matched first */
+    static const char *const order[] = { "%d %d x", "%d,%d", "%d %d" };
+    ScanAlt *alt = my_scanf_alt_compile(order, 3, NULL);
+    ScanCtx *ctx = my_scanf_ctx_new_mem("1 2 q", 5);
+    a = b = 0;
+    w = my_scanf_alt_exec_ctx(ctx, alt, &a, &b);
+    n = my_scanf_ctx(ctx, "%s", s);
+    CHECK_INT("alt: fallback after a longer branch", w == 2 && a == 1 && b == 2 && n == 1 && strcmp(s, "q") == 0, 1);
+    my_scanf_ctx_free(ctx);
+    my_scanf_alt_free(alt);
+
+    static const char *const prio[] = { "%s x %d", "%s", "%s y" };
+    ctx = my_scanf_ctx_new_mem("5 y", 3);
+    w = my_scanf_alt_ctx(ctx, prio, 3, s, &a);
+    CHECK_INT("alt: earlier format preferred", w == 1 && strcmp(s, "5") == 0, 1);
+    my_scanf_ctx_free(ctx);
+
+    /* a losing branch never writes through the arguments, whatever its types */
+    static const char *const mixed[] = { "%lld x", "%hhd" };
+    signed char *small = malloc(1);
+    *small = 0;
+    ctx = my_scanf_ctx_new_mem("5 y", 3);
+    w = my_scanf_alt_ctx(ctx, mixed, 2, small);
+    CHECK_INT("alt: only the winner stores", w == 1 && *small == 5, 1);
+    my_scanf_ctx_free(ctx);
+    free(small);
+
+    /* a failed branch that read past several buffer refills */
+    size_t len = 3 * INBUF_SIZE;
+    char *in = malloc(len + 16);
+    memset(in, '7', len);
+    strcpy(in + len, " end");
+    FILE *fp = tmpfile();
+    if (fp) {
+        fputs(in, fp);
+        rewind(fp);
+        ctx = my_scanf_ctx_new_file(fp);
+        static const char *const longf[] = { "%*d x", "%*s end" };
+        w = my_scanf_alt_ctx(ctx, longf, 2);
+        CHECK_INT("alt: long branch undone", w, 1);
+        CHECK_INT("alt: then at end of input", my_scanf_ctx(ctx, "%s", s), 0);
+        my_scanf_ctx_free(ctx);
+        fclose(fp);
+    }
+    free(in);
+}
+
+static void test_intern(void) {
+    ScanCtx *ctx = my_scanf_ctx_new_mem("INFO a WARN b INFO c", 20);
+    unsigned l1 = 9, l2 = 9, l3 = 9;
+    char s[8];
+    int n = my_scanf_ctx(ctx, "%Is %*s %Is %*s %Is %s", &l1, &l2, &l3, s);
+    CHECK_INT("%Is: n", n, 4);
+    CHECK_INT("%Is: same token, same ID", l1 == 0 && l2 == 1 && l3 == 0, 1);
+    size_t len = 0;
+    const char *t = my_scanf_ctx_intern_str(ctx, l2, &len);
+    CHECK_INT("%Is: canonical text", t && len == 4 && strcmp(t, "WARN") == 0, 1);
+    CHECK_INT("%Is: lookup by text", (int)my_scanf_ctx_intern(ctx, "INFO", 4), 0);
+    CHECK_INT("%Is: unknown ID", my_scanf_ctx_intern_str(ctx, 7, NULL) == NULL, 1);
+    my_scanf_ctx_free(ctx);
+
+    /* enough distinct tokens to grow the table several times */
+    char *in = malloc(100000);
+    size_t k = 0;
+    for (int i = 0; i < 5000; i++) k += (size_t)sprintf(in + k, "tok%d tok%d ", i, i / 2);
+    ctx = my_scanf_ctx_new_mem(in, k);
+    int bad = 0;
+    for (int i = 0; i < 5000; i++) {
+        unsigned a, b;
+        if (my_scanf_ctx(ctx, "%Is %Is", &a, &b) != 2) {
+            bad++;
+            continue;
+        }
+        char want[16];
+        sprintf(want, "tok%d", i / 2);
+        const char *got = my_scanf_ctx_intern_str(ctx, b, NULL);
+        if (!got || strcmp(got, want) != 0) bad++;
+        sprintf(want, "tok%d", i);
+        if ((long)a != my_scanf_ctx_intern(ctx, want, strlen(want))) bad++;
+    }
+    CHECK_INT("%Is: many tokens", bad, 0);
+    my_scanf_ctx_free(ctx);
+
+    /* a token split across two refills */
+    FILE *fp = tmpfile();
+    if (fp) {
+        memset(in, 'x', INBUF_SIZE - 3);
+        strcpy(in + INBUF_SIZE - 3, " ERROR ERROR");
+        fputs(in, fp);
+        rewind(fp);
+        ctx = my_scanf_ctx_new_file(fp);
+        n = my_scanf_ctx(ctx, "%*s %Is %Is", &l1, &l2);
+        t = my_scanf_ctx_intern_str(ctx, l1, NULL);
+        CHECK_INT("%Is: token across refills", n == 2 && l1 == l2 && t && strcmp(t, "ERROR") == 0, 1);
+        my_scanf_ctx_free(ctx);
+        fclose(fp);
+    }
+    free(in);
+
+    /* a push scan that runs out of input mid-token interns nothing */
+    ctx = my_scanf_ctx_new_push();
+    my_scanf_feed(ctx, "ERR", 3);
+    CHECK_INT("%Is: push, token cut short", my_scanf_next(ctx, "%Is %d", &l1, &n), MY_SCANF_NEED_MORE);
+    my_scanf_feed(ctx, "OR 5\n", 5);
+    CHECK_INT("%Is: push, token completed", my_scanf_next(ctx, "%Is %d", &l1, &n), MY_SCANF_RECORD);
+    t = my_scanf_ctx_intern_str(ctx, l1, NULL);
+    CHECK_INT("%Is: push, only the whole token interned",
+              l1 == 0 && n == 5 && t && strcmp(t, "ERROR") == 0 && !my_scanf_ctx_intern_str(ctx, 1, NULL), 1);
+    my_scanf_ctx_free(ctx);
+
+    n = my_sscanf("GET /", "%Is %3Is", &l1, &l2);
+    CHECK_INT("%Is: my_sscanf shares the thread's table",
+              n == 2 && my_scanf_intern("GET", 3) == (long)l1 && strcmp(my_scanf_intern_str(l2, NULL), "/") == 0, 1);
+}
+
+static void test_arrays(void) {
+    int v[4] = {0};
+    int n = my_sscanf("1, 2,3 ,4", "%4,d", v);
+    CHECK_INT("%4,d: n", n, 1);
+    CHECK_INT("%4,d: values", v[0] == 1 && v[1] == 2 && v[2] == 3 && v[3] == 4, 1);
+
+    double f[3] = {0};
+    n = my_sscanf("1.5 2\n3e2", "%3_lf", f);
+    CHECK_INT("%3_lf: whitespace separated", n == 1 && f[0] == 1.5 && f[1] == 2 && f[2] == 300, 1);
+
+    unsigned char h[3] = {0};
+    n = my_sscanf("ff|0a|7", "%3|hhx", h);
+    CHECK_INT("%3|hhx", n == 1 && h[0] == 255 && h[1] == 10 && h[2] == 7, 1);
+
+    long long ll[8];
+    size_t cnt = 8;
+    char c = 0;
+    n = my_sscanf("5,6,-7,;", "%*,lld%c", &cnt, ll, &c);
+    CHECK_INT("%*,lld: count and values", n == 2 && cnt == 3 && ll[0] == 5 && ll[2] == -7, 1);
+    CHECK_INT("%*,lld: trailing separator given back", c, ',');
+    cnt = 2;
+    n = my_sscanf("1;2;3", "%*;lld;%d", &cnt, ll, v);
+    CHECK_INT("%*;lld: stops at the capacity", n == 2 && cnt == 2 && ll[1] == 2 && v[0] == 3, 1);
+
+    v[3] = -1;
+    n = my_sscanf("1,2,3 x", "%4,d", v);
+    CHECK_INT("%4,d: too few elements fails", n == 0 && v[2] == 3 && v[3] == -1, 1);
+
+    n = my_sscanf("9,9,9 4", "%*3,d %d", v);
+    CHECK_INT("%*3,d skips", n == 1 && v[0] == 4, 1);
+    CHECK_INT("array of strings rejected", my_scanf_compile("%3,s", NULL) == NULL, 1);
+    CHECK_INT("%*,Is rejected", my_scanf_compile("%*,Is", NULL) == NULL, 1);
+    CHECK_INT("%3,Is rejected", my_scanf_compile("%3,Is", NULL) == NULL, 1);
+
+    /* a 64-wide row, as one argument */
+    char row[64 * 8];
+    size_t k = 0;
+    for (int i = 0; i < 64; i++) k += (size_t)sprintf(row + k, "%s%d.25", i ? "," : "", i);
+    float fr[64];
+    n = my_sscanf(row, "%64,f", fr);
+    int bad = 0;
+    for (int i = 0; i < 64; i++) bad += (fr[i] != (float)i + 0.25f);
+    CHECK_INT("%64,f row", n == 1 && bad == 0, 1);
+}
+
+static void test_fixed_point(void) {
+    int64_t a = 0, b = 0, c = 0, d = 0;
+    int n = my_sscanf("12.34 -0.5 7 .25", "%.2D %.2D %.2D %.2D", &a, &b, &c, &d);
+    CHECK_INT("%.2D: n", n, 4);
+    CHECK_INT("%.2D: scaled exactly", a == 1234 && b == -50 && c == 700 && d == 25, 1);
+    n = my_sscanf("1.2500 3.", "%.2D %D", &a, &b);
+    CHECK_INT("%.2D: zeros past the scale are fine", n == 2 && a == 125 && b == 3, 1);
+
+    char s[8] = {0};
+    ScanCtx *ctx = my_scanf_ctx_new_mem("1.255 x", 7);
+    n = my_scanf_ctx(ctx, "%.2D", &a);
+    int m = my_scanf_ctx(ctx, "%s", s);
+    CHECK_INT("%.2D: reject leaves the number", n == 0 && m == 1 && strcmp(s, "1.255") == 0, 1);
+    my_scanf_ctx_free(ctx);
+    my_scanf_set_fraction(MY_SCANF_FRAC_TRUNCATE);
+    n = my_sscanf("1.259 -1.259", "%.2D %.2D", &a, &b);
+    CHECK_INT("%.2D: truncate", n == 2 && a == 125 && b == -125, 1);
+    my_scanf_set_fraction(MY_SCANF_FRAC_ROUND);
+    n = my_sscanf("0.125 0.135 0.1251 -2.5 9.99999", "%.2D %.2D %.2D %.0D %.4D", &a, &b, &c, &d, &d);
+    CHECK_INT("%.ND: round half to even", n == 5 && a == 12 && b == 14 && c == 13 && d == 100000, 1);
+    n = my_sscanf("-2.5", "%.0D", &d);
+    CHECK_INT("%.0D: -2.5 -> -2", d == -2, 1);
+    my_scanf_set_fraction(MY_SCANF_FRAC_REJECT);
+
+    errno = 0;
+    n = my_sscanf("922337203685477.5808", "%.4D", &a);
+    CHECK_INT("%.4D: past INT64_MAX", n == 0 && errno == ERANGE, 1);
+    n = my_sscanf("-922337203685477.5808", "%.4D", &a);
+    CHECK_INT("%.4D: INT64_MIN", n == 1 && a == INT64_MIN, 1);
+    n = my_sscanf("12.345 .", "%4.1D%D %D", &a, &b, &c);
+    CHECK_INT("%4.1D: width counts the point", n == 2 && a == 123 && b == 45, 1);
+    CHECK_INT("%.19D rejected", my_scanf_compile("%.19D", NULL) == NULL, 1);
+    CHECK_INT("%.2d rejected", my_scanf_compile("%.2d", NULL) == NULL, 1);
+    CHECK_INT("%.2Is rejected", my_scanf_compile("%.2Is", NULL) == NULL, 1);
+}
+
+static void test_d_ranges(void) {
+    set_stdin_to_string("-128 127 -32768 32767 -2147483648 2147483647 "
+                        "-9223372036854775808 9223372036854775807");
+    signed char hh1 = 0, hh2 = 0; short h1 = 0, h2 = 0; int i1 = 0, i2 = 0;
+    long long ll1 = 0, ll2 = 0;
+    int n = my_scanf("%hhd %hhd %hd %hd %d %d %lld %lld", &hh1, &hh2, &h1, &h2, &i1, &i2, &ll1, &ll2);
+    CHECK_INT("int ranges: n", n, 8);
+    CHECK_INT("%hhd min", hh1, -128);
+    CHECK_INT("%hhd max", hh2, 127);
+    CHECK_INT("%hd min", h1, -32768);
+    CHECK_INT("%hd max", h2, 32767);
+    CHECK_INT("%d min", i1, INT_MIN);
+    CHECK_INT("%d max", i2, INT_MAX);
+    CHECK_INT("%lld min", ll1 == LLONG_MIN, 1);
+    CHECK_INT("%lld max", ll2 == LLONG_MAX, 1);
+
+    /* one past each limit fails with ERANGE */
+    const char *over[] = { "%hhd", "128", "%hd", "-32769", "%d", "2147483648",
+                           "%lld", "9223372036854775808", "%lld", "99999999999999999999999" };
+    for (int k = 0; k < 10; k += 2) {
+        set_stdin_to_string(over[k + 1]);
+        long long big = 0;
+        errno = 0;
+        n = my_scanf(over[k], &big);
+        CHECK_INT(over[k + 1], n, 0);
+        CHECK_INT("overflow sets ERANGE", errno, ERANGE);
+    }
+
+    my_scanf_set_overflow(MY_SCANF_OVERFLOW_SATURATE);
+    set_stdin_to_string("300 -99999999999 0000000000000000000000042");
+    hh1 = 0; i1 = 0; i2 = 0;
+    n = my_scanf("%hhd %d %d", &hh1, &i1, &i2);
+    my_scanf_set_overflow(MY_SCANF_OVERFLOW_FAIL);
+    CHECK_INT("saturate: n", n, 3);
+    CHECK_INT("saturate: %hhd", hh1, 127);
+    CHECK_INT("saturate: %d", i1, INT_MIN);
+    CHECK_INT("leading zeros don't overflow", i2, 42);
+
+    /* width counts digits (not the sign) and leaves the rest, even mid-SWAR-block */
+    set_stdin_to_string("-1234567890123456 12x");
+    ll1 = 0; long long rest = 0; int d = 0; char ch = 0;
+    n = my_scanf("%10lld%lld %2d%c", &ll1, &rest, &d, &ch);
+    CHECK_INT("width digits: n", n, 4);
+    CHECK_INT("width digits: first", ll1 == -1234567890LL, 1);
+    CHECK_INT("width digits: rest", rest == 123456LL, 1);
+    CHECK_INT("width digits: %2d", d, 12);
+    CHECK_INT("width digits: stop char kept", (int)ch, (int)'x');
+}
+
+static void test_x_b_ranges(void) {
+    unsigned char hh = 0; unsigned short h = 0; unsigned long long ll = 0, b64 = 0;
+    int n = my_sscanf("ff 0xFFFF 0xfedcba9876543210 "
+                      "1111111111111111111111111111111111111111111111111111111111111110",
+                      "%hhx %hx %llx %llb", &hh, &h, &ll, &b64);
+    CHECK_INT("x/b ranges: n", n, 4);
+    CHECK_INT("%hhx max", hh, 255);
+    CHECK_INT("%hx max", h, 65535);
+    CHECK_INT("%llx 16 digits", ll == 0xfedcba9876543210ULL, 1);
+    CHECK_INT("%llb 64 digits", b64 == 0xFFFFFFFFFFFFFFFEULL, 1);
+
+    unsigned x = 0;
+    n = my_sscanf("000000000000000000000000000abcdef01 0000000000000000000000000000000101",
+                  "%x %llb", &x, &ll);
+    CHECK_INT("leading zeros are not overflow", n == 2 && x == 0xabcdef01u && ll == 5, 1);
+    n = my_sscanf("0x123456789abcdef0123", "%12x", &ll);
+    CHECK_INT("%x width counts the prefix", n == 0 && errno == ERANGE, 1);
+    n = my_sscanf("0x123456789abcdef0123", "%10llx", &ll);
+    CHECK_INT("%llx width", n == 1 && ll == 0x12345678ULL, 1);
+
+    /* one past each limit fails with ERANGE */
+    const char *over[] = { "%hhx", "100", "%hx", "0x10000", "%x", "1ffffffff",
+                           "%llx", "0x10000000000000000", "%hhb", "100000000",
+                           "%llb", "10000000000000000000000000000000000000000000000000000000000000000" };
+    for (int k = 0; k < 12; k += 2) {
+        unsigned long long big = 0;
+        errno = 0;
+        n = my_sscanf(over[k + 1], over[k], &big);
+        CHECK_INT(over[k + 1], n == 0 && errno == ERANGE, 1);
+    }
+
+    my_scanf_set_overflow(MY_SCANF_OVERFLOW_SATURATE);
+    n = my_sscanf("fff 11111111111111111111111111111111111", "%hhx %b", &hh, &x);
+    CHECK_INT("saturate: %hhx", n == 2 && hh == 255, 1);
+    CHECK_INT("saturate: %b", x == UINT_MAX, 1);
+    my_scanf_set_overflow(MY_SCANF_OVERFLOW_FAIL);
+}
+
+static void test_f_exact(void) {
+    /* must match strtod/strtof bit for bit */
+    const char *cases[] = {
+        "0.1", "3.14159265358979323846264338327950288", "1e23", "9007199254740993",
+        "2.2250738585072011e-308", "2.2250738585072014e-308", "4.9e-324",
+        "2.4703282292062327e-324", "2.4703282292062328e-324",
+        "1.7976931348623157e308", "1.7976931348623158e308", "7.038531e-26",
+        "1.00000005960464477550", "123456789012345678901234567890e-10",
+        "0.000000000000000000000000000000000000000000001e+300", "1e-400", "1e400",
+        "0x1.fffffffffffffp1023", "0x1p-1074", "-0x1.8p1", "0x.8", "0X1P+4",
+        "0x1.000000000000080000000001p0"
+    };
+    int ncases = (int)(sizeof cases / sizeof cases[0]);
+    char input[2048] = "";
+    for (int k = 0; k < ncases; k++) {
+        strcat(input, cases[k]);
+        strcat(input, " ");
+        strcat(input, cases[k]);
+        strcat(input, "\n");
+    }
+    set_stdin_to_string(input);
+    int bad = 0;
+    for (int k = 0; k < ncases; k++) {
+        double d = 0.0; float x = 0.0f;
+        if (my_scanf("%lf %f", &d, &x) != 2) { bad++; continue; }
+        double ed = strtod(cases[k], NULL);
+        float ex = strtof(cases[k], NULL);
+        if (memcmp(&d, &ed, sizeof d) != 0 || memcmp(&x, &ex, sizeof x) != 0) {
+            printf("  mismatch: %s\n", cases[k]);
+            bad++;
+        }
+    }
+    CHECK_INT("%lf/%f match strtod/strtof bit for bit", bad, 0);
+
+    /* 800 digits: needs the slow path */
+    char longnum[820] = "0.";
+    memset(longnum + 2, '7', 800);
+    longnum[802] = '\0';
+    set_stdin_to_string(longnum);
+    double d = 0.0;
+    CHECK_INT("800 digits: n", my_scanf("%lf", &d), 1);
+    CHECK_INT("800 digits: exact", d == strtod(longnum, NULL), 1);
+
+    set_stdin_to_string("inf -Infinity nan NAN(0x1f) infx 0x 1e+ 1.5e3");
+    double a = 0, b = 0, c = 0, e = 0, g = 0, h = 0;
+    char rest[8] = {0}, ch = 0;
+    int n = my_scanf("%lf %lf %lf %lf %lf%c %lf%c", &a, &b, &c, &e, &g, &ch, &h, rest);
+    CHECK_INT("inf/nan/0x: n", n, 8);
+    CHECK_INT("inf", isinf(a) && a > 0, 1);
+    CHECK_INT("-Infinity", isinf(b) && b < 0, 1);
+    CHECK_INT("nan", isnan(c), 1);
+    CHECK_INT("nan(0x1f)", isnan(e), 1);
+    CHECK_INT("\"infx\" leaves x", (int)ch, (int)'x');
+    CHECK_INT("infx is inf", isinf(g), 1);
+    CHECK_DBL("0x with no digits is 0", h, 0.0, 0.0);
+    CHECK_INT("0x leaves x", (int)rest[0], (int)'x');
+
+    float fe = 0;
+    memset(rest, 0, sizeof rest);
+    n = my_scanf("%lf%2c %f", &h, rest, &fe);
+    CHECK_INT("1e+ then number: n", n, 3);
+    CHECK_DBL("1e+ without digits is 1", h, 1.0, 0.0);
+    CHECK_STR("1e+ gives back e+", rest, "e+");
+    CHECK_DBL("next float after bad exponent", (double)fe, 1500.0, 0.0);
+
+    set_stdin_to_string("3.14159");
+    n = my_scanf("%4lf", &h);
+    CHECK_INT("%4lf: n", n, 1);
+    CHECK_DBL("%4lf reads 3.14", h, 3.14, 0.0);
+}
+
+/* ---------- multi-threaded: each thread scans its own stream ---------- */
+
+#define MT_THREADS 8
+#define MT_RECORDS 20000
+
+typedef struct {
+    int id;
+    int errors;
+    int records;
+} MtJob;
+
+static void *mt_worker(void *arg) {
+    MtJob *job = arg;
+    FILE *f = tmpfile();
+    if (!f) { job->errors = -1; return NULL; }
+    for (int i = 0; i < MT_RECORDS; i++) {
+        fprintf(f, "%d t%d_%d %d.25 0x%x\n", i * MT_THREADS + job->id, job->id, i, i, (unsigned)i);
+    }
+    fflush(f);
+    lseek(fileno(f), 0, SEEK_SET);
+
+    ScanCtx *ctx = my_scanf_ctx_new(fileno(f));
+    ScanProg *prog = my_scanf_compile("%d %31s %lf %x", NULL);
+    int k;
+    char s[32], want[32];
+    double v;
+    unsigned int x;
+    /* alternate between the cached-format and compiled-program entry points */
+    for (int i = 0; i < MT_RECORDS; i++) {
+        int n = (i & 1) ? my_scanf_exec_ctx(ctx, prog, &k, s, &v, &x)
+                        : my_scanf_ctx(ctx, "%d %31s %lf %x", &k, s, &v, &x);
+        snprintf(want, sizeof want, "t%d_%d", job->id, i);
+        if (n != 4 || k != i * MT_THREADS + job->id || strcmp(s, want) != 0 ||
+            v != i + 0.25 || x != (unsigned)i) {
+            job->errors++;
+        }
+        job->records++;
+    }
+    if (my_scanf_ctx(ctx, "%d", &k) != 0) job->errors++;   /* nothing left over */
+
+    my_scanf_free(prog);
+    my_scanf_ctx_free(ctx);
+    fclose(f);
+    return NULL;
+}
+
+static void test_threads_independent(void) {
+    pthread_t th[MT_THREADS];
+    MtJob jobs[MT_THREADS];
+    for (int t = 0; t < MT_THREADS; t++) {
+        jobs[t].id = t;
+        jobs[t].errors = 0;
+        jobs[t].records = 0;
+        pthread_create(&th[t], NULL, mt_worker, &jobs[t]);
+    }
+    int errors = 0, records = 0;
+    for (int t = 0; t < MT_THREADS; t++) {
+        pthread_join(th[t], NULL);
+        errors += jobs[t].errors;
+        records += jobs[t].records;
+    }
+    CHECK_INT("threads: records scanned", records, MT_THREADS * MT_RECORDS);
+    CHECK_INT("threads: no cross-talk between contexts", errors, 0);
+}
+
+static void test_sources(void) {
+    /* my_sscanf: in place, and each call starts at the beginning */
+    const char *line = "12 abc 0x1f";
+    int a = 0; char s[16] = {0}; unsigned int x = 0;
+    int n = my_sscanf(line, "%d %s %x", &a, s, &x);
+    CHECK_INT("sscanf: n", n, 3);
+    CHECK_INT("sscanf: a", a, 12);
+    CHECK_STR("sscanf: s", s, "abc");
+    CHECK_UINT("sscanf: x", x, 0x1fu);
+    a = 0;
+    CHECK_INT("sscanf again starts over", my_sscanf(line, "%d", &a) == 1 && a == 12, 1);
+    CHECK_INT("sscanf empty string", my_sscanf("", "%d", &a), 0);
+
+    /* memory context: leftover flows from one call to the next */
+    const char data[] = "1 2 3x";
+    ScanCtx *ctx = my_scanf_ctx_new_mem(data, sizeof data - 1);
+    int b = 0, c = 0; char ch = 0;
+    n = my_scanf_ctx(ctx, "%d", &a);
+    n += my_scanf_ctx(ctx, "%d %d%c", &b, &c, &ch);
+    CHECK_INT("mem ctx: n", n, 4);
+    CHECK_INT("mem ctx: values", a * 100 + b * 10 + c, 123);
+    CHECK_INT("mem ctx: leftover", (int)ch, (int)'x');
+    my_scanf_ctx_free(ctx);
+
+    /* my_fscanf hands back what it read ahead, so stdio sees the rest */
+    FILE *f = tmpfile();
+    for (int i = 0; i < 300; i++) fprintf(f, "%d ", i);
+    fputs("\ntail line\n", f);
+    rewind(f);
+    int sum = 0, v = 0;
+    for (int i = 0; i < 300; i++) {
+        if (my_fscanf(f, "%d", &v) == 1) sum += v;
+    }
+    char rest[32] = {0};
+    int got_lines = (fgets(rest, sizeof rest, f) != NULL) + (fgets(rest, sizeof rest, f) != NULL);
+    CHECK_INT("fscanf: fgets after", got_lines, 2);
+    CHECK_INT("fscanf: 300 calls", sum, 299 * 300 / 2);
+    CHECK_STR("fscanf: stdio continues where we stopped", rest, "tail line\n");
+
+    /* FILE* context on a pipe (not seekable) */
+    int fds[2];
+    if (pipe(fds) == 0) {
+        const char msg[] = "7 pipe_word 8";
+        CHECK_INT("pipe write", (int)write(fds[1], msg, sizeof msg - 1), (int)sizeof msg - 1);
+        close(fds[1]);
+        FILE *pf = fdopen(fds[0], "r");
+        a = b = 0;
+        n = my_fscanf(pf, "%d %s", &a, s);
+        n += my_fscanf(pf, "%d", &b);
+        CHECK_INT("fscanf pipe: n", n, 3);
+        CHECK_STR("fscanf pipe: word", s, "pipe_word");
+        CHECK_INT("fscanf pipe: second call", b, 8);
+        fclose(pf);
+    }
+
+    /* mmap context */
+    rewind(f);
+    CHECK_INT("truncate", ftruncate(fileno(f), 0), 0);
+    for (int i = 0; i < 50000; i++) fprintf(f, "%d\n", i);
+    fflush(f);
+    char path[64];
+    snprintf(path, sizeof path, "/proc/self/fd/%d", fileno(f));
+    ctx = my_scanf_ctx_open_mmap(path);
+    CHECK_INT("mmap: opened", ctx != NULL, 1);
+    if (ctx) {
+        long long total = 0;
+        int count = 0;
+        while (my_scanf_ctx(ctx, "%d", &v) == 1) {
+            total += v;
+            count++;
+        }
+        CHECK_INT("mmap: records", count, 50000);
+        CHECK_INT("mmap: sum", total == 49999LL * 50000 / 2, 1);
+        my_scanf_ctx_free(ctx);
+    }
+    fclose(f);
+}
+
+/* ---------- parallel file scanning ---------- */
+
+typedef struct {
+    int id;
+    double v;
+    char name[16];
+} ParRec;
+
+typedef struct {
+    long count;
+    long long id_sum;
+    int nassigned_sum;
+    size_t last_offset;
+    int out_of_order;
+    double v_sum;
+} ParSeen;
+
+static int par_collect(void *user, size_t offset, const void *rec, int nassigned) {
+    ParSeen *seen = user;
+    const ParRec *r = rec;
+    if (seen->count > 0 && offset <= seen->last_offset) seen->out_of_order++;
+    seen->last_offset = offset;
+    seen->count++;
+    seen->id_sum += r->id;
+    seen->nassigned_sum += nassigned;
+    seen->v_sum += r->v;
+    return 0;
+}
+
+static int par_collect_atomic(void *user, size_t offset, const void *rec, int nassigned) {
+    ParSeen *seen = user;
+    const ParRec *r = rec;
+    (void)offset;
+    __atomic_add_fetch(&seen->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&seen->id_sum, r->id, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&seen->nassigned_sum, nassigned, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static int par_stop_early(void *user, size_t offset, const void *rec, int nassigned) {
+    (void)offset; (void)rec; (void)nassigned;
+    return ++*(long *)user >= 10;
+}
+
+static void test_file_parallel(void) {
+    const char *path = "my_scanf_test_parallel.txt";
+    FILE *f = fopen(path, "wb");
+    if (!f) return;
+    int lines = 400000;
+    for (int i = 0; i < lines; i++) {
+        if (i == 1234) fputs("garbage line\n", f);
+        else fprintf(f, "%d %d.5 n%d\n", i, i % 1000, i % 97);
+    }
+    fputs("7 8.5", f);   /* last line without a newline */
+    fclose(f);
+
+    const char *fmt = "%d %lf %15s";
+    size_t offs[] = { offsetof(ParRec, id), offsetof(ParRec, v), offsetof(ParRec, name) };
+    ScanRecLayout layout = { sizeof(ParRec), 3, offs, NULL, NULL, NULL };
+
+    /* serial reference: my_sscanf on every line */
+    ParSeen ref;
+    memset(&ref, 0, sizeof ref);
+    f = fopen(path, "rb");
+    char line[64];
+    size_t off = 0;
+    while (fgets(line, sizeof line, f)) {
+        ParRec r;
+        memset(&r, 0, sizeof r);
+        int n = my_sscanf(line, fmt, &r.id, &r.v, r.name);
+        par_collect(&ref, off, &r, n);
+        off += strlen(line);
+    }
+    fclose(f);
+
+    ParSeen seen;
+    memset(&seen, 0, sizeof seen);
+    long total = my_scanf_file_parallel(path, fmt, 4, &layout, par_collect, &seen, 0);
+    CHECK_INT("parallel: records", (int)total, lines + 1);
+    CHECK_INT("parallel: delivered in order", seen.out_of_order, 0);
+    CHECK_INT("parallel: same records as serial", seen.count == ref.count && seen.id_sum == ref.id_sum, 1);
+    CHECK_INT("parallel: same assignment counts", seen.nassigned_sum, ref.nassigned_sum);
+    CHECK_INT("parallel: same values", seen.v_sum == ref.v_sum, 1);
+
+    memset(&seen, 0, sizeof seen);
+    total = my_scanf_file_parallel(path, fmt, 3, &layout, par_collect_atomic, &seen, MY_SCANF_UNORDERED);
+    CHECK_INT("parallel unordered: records", (int)total, lines + 1);
+    CHECK_INT("parallel unordered: same ids", seen.id_sum == ref.id_sum, 1);
+    CHECK_INT("parallel unordered: same assignment counts", seen.nassigned_sum, ref.nassigned_sum);
+
+    long calls = 0;
+    total = my_scanf_file_parallel(path, fmt, 2, &layout, par_stop_early, &calls, 0);
+    CHECK_INT("parallel: sink can stop the scan", (int)total, 10);
+
+    layout.nfields = 2;
+    errno = 0;
+    total = my_scanf_file_parallel(path, fmt, 2, &layout, par_collect, &seen, 0);
+    CHECK_INT("parallel: layout too small", total == -1 && errno == EINVAL, 1);
+    layout.nfields = 3;
+    void *cols[3] = { NULL, NULL, NULL };
+    layout.columns = cols;
+    errno = 0;
+    total = my_scanf_file_parallel(path, fmt, 2, &layout, par_collect, &seen, 0);
+    CHECK_INT("parallel: no column layout", total == -1 && errno == EINVAL, 1);
+    layout.columns = NULL;
+    errno = 0;
+    total = my_scanf_file_parallel(path, "%*,d", 2, &layout, par_collect, &seen, 0);
+    CHECK_INT("parallel: %*,d refused", total == -1 && errno == EINVAL, 1);
+    remove(path);
+}
+
+typedef struct {
+    ScanCtx *ctx;
+    long n;
+    int done;
+} RecordsPipe;
+
+static void *records_pipe_run(void *arg) {
+    RecordsPipe *rp = arg;
+    int v = 0;
+    size_t offs[] = { 0 };
+    ScanRecLayout lay = { sizeof v, 1, offs, &v, NULL, NULL };
+    ScanBatchStatus st;
+    rp->n = my_scanf_records_ctx(rp->ctx, "%d;", 1, &lay, &st);
+    __atomic_store_n(&rp->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void test_records_batch(void) {
+    typedef struct { int id; char name[8]; double v; } Row;
+    size_t offs[] = { offsetof(Row, id), offsetof(Row, name), offsetof(Row, v) };
+    Row rows[8];
+    memset(rows, 0, sizeof rows);
+    ScanRecLayout aos = { sizeof(Row), 3, offs, rows, NULL, NULL };
+    ScanBatchStatus st;
+
+    set_stdin_to_string("1 a 0.5\n2 bb 1.5\n3 ccc 2.5\n4 dddd x\n5 e 4.5\n");
+    long n = my_scanf_records("%d %7s %lf", 8, &aos, &st);
+    CHECK_INT("records AoS: completed", (int)n, 3);
+    CHECK_INT("records AoS: row 2 id", rows[2].id, 3);
+    CHECK_STR("records AoS: row 1 name", rows[1].name, "bb");
+    CHECK_DBL("records AoS: row 2 v", rows[2].v, 2.5, 0.0);
+    CHECK_INT("records AoS: failing record", (int)st.record, 3);
+    CHECK_INT("records AoS: failing field", st.field, 2);
+    CHECK_INT("records AoS: not at eof", st.eof, 0);
+
+    /* columns, with a suppressed conversion in the middle */
+    int ids[4] = {0};
+    double vals[4] = {0};
+    void *cols[] = { ids, vals };
+    size_t sizes[] = { sizeof ids[0], sizeof vals[0] };
+    ScanRecLayout soa = { 0, 2, NULL, NULL, cols, sizes };
+    set_stdin_to_string("10 skip 1e1\n20 skip 2e1\n30 skip 3e1\n");
+    n = my_scanf_records("%d %*s %lf", 4, &soa, &st);
+    CHECK_INT("records SoA: completed", (int)n, 3);
+    CHECK_INT("records SoA: ids", ids[0] + ids[1] + ids[2], 60);
+    CHECK_DBL("records SoA: vals", vals[0] + vals[1] + vals[2], 60.0, 0.0);
+    CHECK_INT("records SoA: clean end", st.record == 3 && st.field == 0 && st.eof, 1);
+
+    /* only suppressed conversions: stops at the end of input */
+    set_stdin_to_string("1 2 3 \n");
+    n = my_scanf_records("%*d", 8, &soa, &st);
+    CHECK_INT("records: %*d stops at the end", n == 3 && st.record == 3 && st.field == 0 && st.eof, 1);
+    set_stdin_to_string("");
+    n = my_scanf_records(" ", 8, &soa, &st);
+    CHECK_INT("records: nothing consumed, no record", n == 0 && st.eof, 1);
+
+    /* all n records read from a pipe that stays open: returns without
+       waiting for more input */
+    int pfd[2];
+    if (pipe(pfd) == 0) {
+        CHECK_INT("records pipe: write", (int)write(pfd[1], "5;", 2), 2);
+        RecordsPipe rp = { my_scanf_ctx_new(pfd[0]), 0, 0 };
+        pthread_t th;
+        pthread_create(&th, NULL, records_pipe_run, &rp);
+        for (int ms = 0; ms < 2000 && !__atomic_load_n(&rp.done, __ATOMIC_ACQUIRE); ms += 10)
+            usleep(10000);
+        int done = __atomic_load_n(&rp.done, __ATOMIC_ACQUIRE);
+        close(pfd[1]);      // unblocks a reader stuck past the last record
+        pthread_join(th, NULL);
+        CHECK_INT("records pipe: no read past the last record", done && rp.n == 1, 1);
+        my_scanf_ctx_free(rp.ctx);
+        close(pfd[0]);
+    }
+
+    soa.nfields = 1;
+    errno = 0;
+    CHECK_INT("records: layout too small", my_scanf_records("%d %lf", 4, &soa, NULL) == -1 && errno == EINVAL, 1);
+    CHECK_INT("records: bad format", (int)my_scanf_records("%d %y", 4, &aos, NULL), -1);
+}
+
+static void test_views(void) {
+    /* in place over a string */
+    const char *line = "  key \"two words\" tail of line\nnext";
+    ScanView k, q, r;
+    int n = my_sscanf(line, "%vs %vq %vr", &k, &q, &r);
+    CHECK_INT("views: n", n, 3);
+    CHECK_INT("views: %vs points into input", k.ptr == line + 2 && k.len == 3, 1);
+    CHECK_INT("views: %vq inside quotes", q.len == 9 && memcmp(q.ptr, "two words", 9) == 0, 1);
+    CHECK_INT("views: %vr to newline", r.len == 12 && memcmp(r.ptr, "tail of line", 12) == 0, 1);
+    n = my_sscanf("abcdef", "%3vs%vs", &k, &q);
+    CHECK_INT("views: width", n == 2 && k.len == 3 && q.len == 3 && q.ptr == k.ptr + 3, 1);
+    CHECK_INT("views: bad length", my_sscanf("x", "%lvs", &k), 0);
+
+    /* buffered: a long view must survive a refill caused by a later one */
+    size_t pad = INBUF_SIZE - 4;
+    char *big = malloc(pad + 32);
+    memset(big, 'a', pad);
+    strcpy(big + pad, " abcdefgh rest");
+    set_stdin_to_string(big);
+    char tail[8] = {0};
+    n = my_scanf("%vs %vs %s", &k, &q, tail);
+    CHECK_INT("views refill: n", n, 3);
+    CHECK_INT("views refill: first kept", k.len == pad && k.ptr[0] == 'a' && k.ptr[pad - 1] == 'a', 1);
+    CHECK_INT("views refill: straddling", q.len == 8 && memcmp(q.ptr, "abcdefgh", 8) == 0, 1);
+    CHECK_STR("views refill: next", tail, "rest");
+    free(big);
+
+    /* my_fscanf keeps no buffer, so it has nothing to point into */
+    FILE *fp = tmpfile();
+    fputs("word", fp);
+    rewind(fp);
+    CHECK_INT("views: not with my_fscanf", my_fscanf(fp, "%vs", &k), 0);
+    fclose(fp);
+}
+
+static void test_alloc_strings(void) {
+    char *a = NULL, *q = NULL, *r = NULL;
+    int n = my_sscanf("word \"quoted text\" rest of it\n", "%ms %mq %mr", &a, &q, &r);
+    CHECK_INT("%m: n", n, 3);
+    CHECK_STR("%ms", a, "word");
+    CHECK_STR("%mq", q, "quoted text");
+    CHECK_STR("%mr", r, "rest of it");
+    n = my_sscanf("abcdef", "%3ms", &a);
+    CHECK_STR("%ms width", a, "abc");
+
+    /* longer than an arena block */
+    size_t big_len = 3 * ARENA_BLOCK + 5;
+    char *big = malloc(big_len + 3);
+    memset(big, 'z', big_len);
+    strcpy(big + big_len, " y");
+    char *s1 = NULL, *s2 = NULL;
+    n = my_sscanf(big, "%ms %ms", &s1, &s2);
+    CHECK_INT("%ms long: n", n, 2);
+    CHECK_INT("%ms long: length", (int)strlen(s1), (int)big_len);
+    CHECK_STR("%ms long: next", s2, "y");
+    free(big);
+
+    /* nothing read: destination untouched */
+    char *none = NULL;
+    CHECK_INT("%ms at end", my_sscanf("   ", "%ms", &none), 0);
+    CHECK_INT("%ms at end: untouched", none == NULL, 1);
+    CHECK_INT("%m with a length", my_sscanf("x", "%mls", &none), 0);
+
+    /* a batch of records, released together */
+    ScanCtx *ctx = my_scanf_ctx_new_mem("1 one\n2 two\n3 three\n", 20);
+    typedef struct { int id; char *name; } Row;
+    Row rows[3];
+    size_t offs[] = { offsetof(Row, id), offsetof(Row, name) };
+    ScanRecLayout lay = { sizeof(Row), 2, offs, rows, NULL, NULL };
+    long got = my_scanf_records_ctx(ctx, "%d %ms", 3, &lay, NULL);
+    CHECK_INT("%ms records: n", (int)got, 3);
+    CHECK_STR("%ms records: last", rows[2].name, "three");
+    my_scanf_ctx_arena_reset(ctx);
+    my_scanf_ctx_free(ctx);
+
+    my_scanf_arena_reset();
+    my_sscanf("first", "%ms", &a);
+    my_scanf_arena_reset();
+    my_sscanf("again", "%ms", &q);
+    CHECK_INT("arena reset: memory reused", a == q, 1);
+    CHECK_STR("arena reset: new string", q, "again");
+    my_scanf_arena_reset();
+}
+
+static void put_str(int fd, const char *str) {
+    CHECK_INT("push: write", (int)write(fd, str, strlen(str)), (int)strlen(str));
+}
+
+/* reads whatever the non-blocking fd has and feeds it; returns bytes fed */
+static ssize_t feed_from(ScanCtx *ctx, int fd) {
+    char buf[64];
+    ssize_t total = 0, n;
+    while ((n = read(fd, buf, sizeof buf)) > 0) {
+        my_scanf_feed(ctx, buf, (size_t)n);
+        total += n;
+    }
+    if (n == 0) my_scanf_feed(ctx, NULL, 0);
+    return total;
+}
+
+static void test_push(void) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        CHECK_INT("push: socketpair", 0, 1);
+        return;
+    }
+    fcntl(sv[0], F_SETFL, O_NONBLOCK);
+    ScanCtx *ctx = my_scanf_ctx_new_push();
+    const char *fmt = "%d %q %lf";
+    int id = 0; char name[32] = {0}; double v = 0;
+
+    /* halfway through the quoted string, then through the exponent */
+    put_str(sv[1], "12 \"hal");
+    feed_from(ctx, sv[0]);
+    CHECK_INT("push: inside %q", my_scanf_next(ctx, fmt, &id, name, &v), MY_SCANF_NEED_MORE);
+    put_str(sv[1], "f done\" 3.5e");
+    feed_from(ctx, sv[0]);
+    CHECK_INT("push: inside exponent", my_scanf_next(ctx, fmt, &id, name, &v), MY_SCANF_NEED_MORE);
+    put_str(sv[1], "2\n7 x 1\nbad");
+    feed_from(ctx, sv[0]);
+    CHECK_INT("push: record", my_scanf_next(ctx, fmt, &id, name, &v), MY_SCANF_RECORD);
+    CHECK_INT("push: values", id == 12 && strcmp(name, "half done") == 0 && v == 350.0, 1);
+    CHECK_INT("push: second record", my_scanf_next(ctx, fmt, &id, name, &v), MY_SCANF_RECORD);
+    CHECK_INT("push: second values", id == 7 && strcmp(name, "x") == 0 && v == 1.0, 1);
+    CHECK_INT("push: mismatch", my_scanf_next(ctx, fmt, &id, name, &v), MY_SCANF_MISMATCH);
+    CHECK_INT("push: skip the line", my_scanf_next(ctx, "%*s"), MY_SCANF_NEED_MORE);
+
+    put_str(sv[1], " 9 \"z\" 2");
+    close(sv[1]);
+    feed_from(ctx, sv[0]);
+    CHECK_INT("push: skip after more input", my_scanf_next(ctx, "%*s"), MY_SCANF_RECORD);
+    CHECK_INT("push: last record at end of input", my_scanf_next(ctx, fmt, &id, name, &v), MY_SCANF_RECORD);
+    CHECK_INT("push: last values", id == 9 && v == 2.0, 1);
+    CHECK_INT("push: end", my_scanf_next(ctx, fmt, &id, name, &v), MY_SCANF_END);
+    close(sv[0]);
+    my_scanf_ctx_free(ctx);
+
+    /* a pipe fed one byte at a time gives the same records */
+    int pfd[2];
+    if (pipe(pfd) != 0) return;
+    const char *text = "1 \"a b\" 0.5\n2 c -1e-3\n3 \"\" 4\n";
+    CHECK_INT("push pipe: write", (int)write(pfd[1], text, strlen(text)), (int)strlen(text));
+    close(pfd[1]);
+    ctx = my_scanf_ctx_new_push();
+    int records = 0, need_more = 0, sum = 0, r;
+    char c;
+    while (read(pfd[0], &c, 1) == 1) {
+        my_scanf_feed(ctx, &c, 1);
+        while ((r = my_scanf_next(ctx, fmt, &id, name, &v)) == MY_SCANF_RECORD) {
+            records++;
+            sum += id;
+        }
+        if (r == MY_SCANF_NEED_MORE) need_more++;
+    }
+    my_scanf_feed(ctx, NULL, 0);
+    while ((r = my_scanf_next(ctx, fmt, &id, name, &v)) == MY_SCANF_RECORD) {
+        records++;
+        sum += id;
+    }
+    CHECK_INT("push pipe: records", records, 3);
+    CHECK_INT("push pipe: ids", sum, 6);
+    CHECK_INT("push pipe: ends cleanly", r, MY_SCANF_END);
+    CHECK_INT("push pipe: waited for input", need_more > 0, 1);
+    close(pfd[0]);
+    my_scanf_ctx_free(ctx);
+
+    /* each NEED_MORE attempt rescans only the pending record: a token of
+       n bytes fed in k-byte pieces costs about n^2/2k byte reads, and the
+       records consumed before it cost nothing */
+    enum { TOKEN = 64 * 1024, PIECE = 256 };
+    char *tok = malloc(TOKEN + 1), *out = malloc(TOKEN + 1);
+    memset(tok, 'a', TOKEN);
+    tok[TOKEN] = '\n';
+    ctx = my_scanf_ctx_new_push();
+    for (int i = 0; i < 100; i++) my_scanf_feed(ctx, "x ", 2);
+    while (my_scanf_next(ctx, "%1s", out) == MY_SCANF_RECORD) {}
+    uint64_t rescanned = 0;
+    r = MY_SCANF_NEED_MORE;
+    for (size_t at = 0; at <= TOKEN && r == MY_SCANF_NEED_MORE; at += PIECE) {
+        my_scanf_feed(ctx, tok + at, at + PIECE <= TOKEN ? PIECE : TOKEN + 1 - at);
+        r = my_scanf_next(ctx, "%s", out);
+        if (r == MY_SCANF_NEED_MORE) rescanned += ctx->len - ctx->pos;
+    }
+    CHECK_INT("push: long token in pieces", r == MY_SCANF_RECORD && strlen(out) == TOKEN, 1);
+    CHECK_INT("push: rescan cost bounded by n^2/2k",
+              rescanned <= (uint64_t)TOKEN * TOKEN / (2 * PIECE) + TOKEN, 1);
+    my_scanf_ctx_free(ctx);
+    free(tok);
+    free(out);
+}
+
+static const ScanConvStats *stats_for(const ScanStats *st, char conv) {
+    for (int k = 0; k < MY_SCANF_STAT_NCONV; k++) {
+        if (st->conv[k].conv == conv) return &st->conv[k];
+    }
+    return NULL;
+}
+
+static void test_stats(void) {
+    ScanStats st;
+    my_scanf_stats_reset();
+    if (!my_scanf_stats(&st)) {
+        CHECK_INT("stats: off by default", stats_for(&st, 'd')->calls == 0, 1);
+        return;
+    }
+
+    int d = 0; char buf[8]; unsigned x = 0;
+    my_sscanf("12 ab 0x1f", "%d %s %x", &d, buf, &x);
+    my_sscanf("zz", "%d", &d);
+    my_sscanf("1e+", "%lf%2c", (double*)buf, buf);   /* gives back "e+" */
+    my_scanf_stats(&st);
+
+    const ScanConvStats *sd = stats_for(&st, 'd');
+    CHECK_INT("stats: %d calls", (int)sd->calls, 2);
+    CHECK_INT("stats: %d failures", (int)sd->failures, 1);
+    CHECK_INT("stats: %d bytes", (int)sd->bytes, 2);
+    CHECK_INT("stats: %s bytes", (int)stats_for(&st, 's')->bytes, 2);
+    CHECK_INT("stats: %x bytes", (int)stats_for(&st, 'x')->bytes, 4);
+    CHECK_INT("stats: %f pushback", (int)stats_for(&st, 'f')->pushback_max, 2);
+    uint64_t hist = 0;
+    for (int k = 0; k < MY_SCANF_STAT_BUCKETS; k++) hist += sd->ticks[k];
+    CHECK_INT("stats: histogram covers every call", (int)hist, 2);
+
+    my_scanf_stats_reset();
+    my_scanf_stats(&st);
+    CHECK_INT("stats: reset", (int)stats_for(&st, 'd')->calls, 0);
+}
+
+
+/* =============================
+   Benchmarks (--bench)
+   Deterministic corpora, one field per line, scanned by my_scanf and by
+   glibc. Results go to bench_output.txt as tab-separated lines;
+   --baseline FILE compares them with an earlier run.
+   ============================= */
+#include <time.h>
+
+typedef enum { BK_INT, BK_LLONG, BK_UINT, BK_DOUBLE, BK_STR } BenchKind;
+
+typedef struct {
+    const char *name;
+    BenchKind kind;
+    const char *my_fmt;
+    const char *libc_fmt;   // NULL: glibc has no such conversion
+    int base;               // strtol/strtoul base; 0 for strtod; -1: no strto* loop
+} BenchCorpus;
+
+static const BenchCorpus bench_corpora[] = {
+    { "int_dense", BK_INT,    "%d",   "%d",              10 },
+    { "int_large", BK_LLONG,  "%lld", "%lld",            10 },
+    { "hex_0x",    BK_UINT,   "%x",   "%x",              16 },
+    { "hex_plain", BK_UINT,   "%x",   "%x",              16 },
+    { "bin",       BK_UINT,   "%b",   NULL,               2 },
+    { "float",     BK_DOUBLE, "%lf",  "%lf",              0 },
+    { "quoted",    BK_STR,    "%q",   " \"%1023[^\"]\"", -1 },
+    { "line",      BK_STR,    "%r",   " %1023[^\n]",     -1 },
+};
+#define BENCH_NCORPORA ((int)(sizeof bench_corpora / sizeof bench_corpora[0]))
+
+typedef enum { BI_MY_SCANF, BI_SCANF, BI_MY_SSCANF, BI_SSCANF, BI_MY_CTX, BI_STRTO, BI_COUNT } BenchImpl;
+
+static const char *const bench_impl_names[BI_COUNT] = {
+    "my_scanf", "scanf", "my_sscanf", "sscanf", "my_scanf_ctx", "strto"
+};
+
+static uint64_t bench_rand(uint64_t *st) {
+    // xorshift64*
+    *st ^= *st >> 12;
+    *st ^= *st << 25;
+    *st ^= *st >> 27;
+    return *st * 0x2545F4914F6CDD1DULL;
+}
+
+// Writes one field of corpus c to out (room for 256 bytes); returns its length.
+static int bench_field(const BenchCorpus *c, uint64_t *rng, char *out) {
+    uint64_t r = bench_rand(rng);
+    switch (c - bench_corpora) {
+        case 0: return sprintf(out, "%u", (unsigned)(r % 100000));
+        case 1: return sprintf(out, "%lld", (long long)r);
+        case 2: return sprintf(out, "0x%x", (unsigned)r);
+        case 3: return sprintf(out, "%x", (unsigned)r);
+        case 4: {
+            unsigned v = (unsigned)(r >> 40);
+            int n = 0;
+            for (int b = 23; b >= 0; b--) {
+                if (n > 0 || (v >> b) & 1 || b == 0) out[n++] = (char)('0' + ((v >> b) & 1));
+            }
+            out[n] = '\0';
+            return n;
+        }
+        case 5: {
+            double v = ldexp((double)(r >> 11), -53) * pow(10.0, (double)((int)(r % 61) - 30));
+            if (r & 1) v = -v;
+            return sprintf(out, "%.*e", 1 + (int)((r >> 8) % 16), v);
+        }
+        case 6: {
+            int n = 0, words = 1 + (int)(r % 6);
+            out[n++] = '"';
+            for (int w = 0; w < words; w++) {
+                if (w > 0) out[n++] = ' ';
+                int wl = 1 + (int)(bench_rand(rng) % 8);
+                for (int k = 0; k < wl; k++) out[n++] = (char)('a' + bench_rand(rng) % 26);
+            }
+            out[n++] = '"';
+            out[n] = '\0';
+            return n;
+        }
+        default: {
+            int n = 40 + (int)(r % 161);
+            for (int k = 0; k < n; k++) {
+                uint64_t x = bench_rand(rng) % 32;
+                out[k] = (k > 0 && x >= 26) ? ' ' : (char)('a' + x % 26);
+            }
+            out[n] = '\0';
+            return n;
+        }
+    }
+}
+
+typedef struct {
+    char *text;     // the corpus, NUL-terminated
+    char *lines;    // same, with each '\n' replaced by '\0'
+    size_t len;
+    size_t fields;
+} BenchData;
+
+static void bench_make(const BenchCorpus *c, size_t size, BenchData *d) {
+    uint64_t rng = 0x9E3779B97F4A7C15ULL ^ (uint64_t)(c - bench_corpora);
+    d->text = malloc(size + 512);
+    d->len = 0;
+    d->fields = 0;
+    while (d->len < size) {
+        d->len += (size_t)bench_field(c, &rng, d->text + d->len);
+        d->text[d->len++] = '\n';
+        d->fields++;
+    }
+    d->text[d->len] = '\0';
+    d->lines = malloc(d->len + 1);
+    memcpy(d->lines, d->text, d->len + 1);
+    for (size_t i = 0; i < d->len; i++) {
+        if (d->lines[i] == '\n') d->lines[i] = '\0';
+    }
+}
+
+typedef struct {
+    size_t fields;
+    uint64_t sum;   // checksum of every value, to compare implementations
+} BenchRun;
+
+static inline void bench_add(BenchRun *r, uint64_t v) {
+    r->fields++;
+    r->sum = r->sum * 31 + v;
+}
+
+static inline uint64_t bench_dbl(double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof bits);
+    return bits;
+}
+
+static inline uint64_t bench_str(const char *v) {
+    return strlen(v) * 256 + (unsigned char)v[0];
+}
+
+// Runs SCAN(dst) until it fails, folding each value into r.
+#define BENCH_LOOP(kind, r, SCAN) do { \
+    switch (kind) { \
+        case BK_INT:    { int v;          while (SCAN(&v)) bench_add(&(r), (uint64_t)v); break; } \
+        case BK_LLONG:  { long long v;    while (SCAN(&v)) bench_add(&(r), (uint64_t)v); break; } \
+        case BK_UINT:   { unsigned v;     while (SCAN(&v)) bench_add(&(r), v); break; } \
+        case BK_DOUBLE: { double v;       while (SCAN(&v)) bench_add(&(r), bench_dbl(v)); break; } \
+        case BK_STR:    { static char v[1024]; while (SCAN(v)) bench_add(&(r), bench_str(v)); break; } \
+    } \
+} while (0)
+
+// next line of d->lines at or after *p, or NULL at the end
+static inline const char *bench_line(const BenchData *d, const char **p) {
+    const char *line = *p;
+    if (line >= d->lines + d->len) return NULL;
+    *p = line + strlen(line) + 1;
+    return line;
+}
+
+static BenchRun bench_strto(const BenchCorpus *c, const BenchData *d) {
+    BenchRun r = { 0, 0 };
+    const char *p = d->text;
+    char *e;
+    for (;;) {
+        uint64_t v;
+        if (c->kind == BK_DOUBLE) v = bench_dbl(strtod(p, &e));
+        else if (c->kind == BK_UINT) v = strtoul(p, &e, c->base);
+        else v = (uint64_t)strtoll(p, &e, c->base);
+        if (e == p) break;
+        if (c->kind == BK_INT) v = (uint64_t)(int)v;
+        else if (c->kind == BK_UINT) v = (unsigned)v;
+        bench_add(&r, v);
+        p = e;
+    }
+    return r;
+}
+
+static void bench_rewind_stdin(void) {
+    rewind(stdin);
+    reset_unread_buffer();
+}
+
+static BenchRun bench_run(BenchImpl impl, const BenchCorpus *c, const BenchData *d) {
+    BenchRun r = { 0, 0 };
+    const char *p = d->lines;
+    const char *line;
+    switch (impl) {
+        case BI_MY_SCANF:
+            bench_rewind_stdin();
+#define SCAN(dst) (my_scanf(c->my_fmt, dst) == 1)
+            BENCH_LOOP(c->kind, r, SCAN);
+#undef SCAN
+            break;
+        case BI_SCANF:
+            bench_rewind_stdin();
+#define SCAN(dst) (scanf(c->libc_fmt, dst) == 1)
+            BENCH_LOOP(c->kind, r, SCAN);
+#undef SCAN
+            break;
+        case BI_MY_SSCANF:
+#define SCAN(dst) ((line = bench_line(d, &p)) && my_sscanf(line, c->my_fmt, dst) == 1)
+            BENCH_LOOP(c->kind, r, SCAN);
+#undef SCAN
+            break;
+        case BI_SSCANF:
+#define SCAN(dst) ((line = bench_line(d, &p)) && sscanf(line, c->libc_fmt, dst) == 1)
+            BENCH_LOOP(c->kind, r, SCAN);
+#undef SCAN
+            break;
+        case BI_MY_CTX: {
+            ScanCtx *ctx = my_scanf_ctx_new_mem(d->text, d->len);
+#define SCAN(dst) (my_scanf_ctx(ctx, c->my_fmt, dst) == 1)
+            BENCH_LOOP(c->kind, r, SCAN);
+#undef SCAN
+            my_scanf_ctx_free(ctx);
+            break;
+        }
+        case BI_STRTO:
+            r = bench_strto(c, d);
+            break;
+        default:
+            break;
+    }
+    return r;
+}
+
+static int bench_applies(BenchImpl impl, const BenchCorpus *c) {
+    if (impl == BI_SCANF || impl == BI_SSCANF) return c->libc_fmt != NULL;
+    if (impl == BI_STRTO) return c->base >= 0;
+    return 1;
+}
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct {
+    char corpus[32];
+    char impl[32];
+    double ns_per_field;
+    double mb_s;
+} BenchResult;
+
+// Reads results written by an earlier run; returns how many (at most max).
+static int bench_load(const char *path, BenchResult *out, int max) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char buf[256];
+    int n = 0;
+    while (n < max && fgets(buf, sizeof buf, f)) {
+        if (buf[0] == '#') continue;
+        BenchResult *b = &out[n];
+        if (sscanf(buf, "%31s %31s %*s %*s %lf %lf", b->corpus, b->impl, &b->ns_per_field, &b->mb_s) == 4) n++;
+    }
+    fclose(f);
+    return n;
+}
+
+static int bench_main(int argc, char **argv) {
+    size_t size = 4u << 20;
+    int reps = 3;
+    double threshold = 10.0;
+    const char *out_path = "bench_output.txt";
+    const char *baseline = NULL;
+
+    for (int i = 0; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (v && strcmp(a, "--size") == 0) { size = (size_t)(atof(v) * (1 << 20)); i++; }
+        else if (v && strcmp(a, "--reps") == 0) { reps = atoi(v); i++; }
+        else if (v && strcmp(a, "--out") == 0) { out_path = v; i++; }
+        else if (v && strcmp(a, "--baseline") == 0) { baseline = v; i++; }
+        else if (v && strcmp(a, "--threshold") == 0) { threshold = atof(v); i++; }
+        else {
+            fprintf(stderr, "usage: --bench [--size MB] [--reps N] [--out FILE]"
+                            " [--baseline FILE] [--threshold PCT]\n");
+            return 2;
+        }
+    }
+    if (reps < 1) reps = 1;
+
+    BenchResult old[BENCH_NCORPORA * BI_COUNT];
+    int nold = 0;
+    if (baseline) {
+        nold = bench_load(baseline, old, BENCH_NCORPORA * BI_COUNT);
+        if (nold < 0) {
+            perror(baseline);
+            return 2;
+        }
+    }
+
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        perror(out_path);
+        return 2;
+    }
+    fprintf(out, "# my_scanf bench: size=%zu reps=%d\n", size, reps);
+    fprintf(out, "# corpus\timpl\tfields\tbytes\tns_per_field\tmb_per_s\tchecksum\n");
+
+    printf("%-10s %-13s %10s %9s %9s", "corpus", "impl", "fields", "ns/field", "MB/s");
+    if (baseline) printf(" %9s", "vs base");
+    printf("\n");
+
+    int regressions = 0;
+    for (int ci = 0; ci < BENCH_NCORPORA; ci++) {
+        const BenchCorpus *c = &bench_corpora[ci];
+        BenchData d;
+        bench_make(c, size, &d);
+        set_stdin_to_string(d.text);
+
+        uint64_t ref_sum = 0;
+        int have_ref = 0;
+        for (int ii = 0; ii < BI_COUNT; ii++) {
+            BenchImpl impl = (BenchImpl)ii;
+            if (!bench_applies(impl, c)) continue;
+
+            BenchRun run = { 0, 0 };
+            uint64_t best = UINT64_MAX;
+            for (int rep = 0; rep < reps; rep++) {
+                uint64_t t0 = bench_now_ns();
+                run = bench_run(impl, c, &d);
+                uint64_t t = bench_now_ns() - t0;
+                if (t < best) best = t;
+            }
+
+            double nsf = run.fields ? (double)best / (double)run.fields : 0.0;
+            double mbs = (double)d.len / (1 << 20) / ((double)best / 1e9);
+            const char *name = bench_impl_names[impl];
+            fprintf(out, "%s\t%s\t%zu\t%zu\t%.2f\t%.1f\t%016llx\n", c->name, name,
+                    run.fields, d.len, nsf, mbs, (unsigned long long)run.sum);
+            printf("%-10s %-13s %10zu %9.2f %9.1f", c->name, name, run.fields, nsf, mbs);
+
+            for (int k = 0; k < nold; k++) {
+                if (strcmp(old[k].corpus, c->name) != 0 || strcmp(old[k].impl, name) != 0) continue;
+                double delta = (mbs / old[k].mb_s - 1.0) * 100.0;
+                printf(" %+8.1f%%", delta);
+                if (delta < -threshold) {
+                    printf("  REGRESSION");
+                    regressions++;
+                }
+                break;
+            }
+            if (run.fields != d.fields) printf("  (stopped after %zu of %zu)", run.fields, d.fields);
+            else if (have_ref && run.sum != ref_sum) printf("  (checksum differs)");
+            if (!have_ref && run.fields == d.fields) {
+                ref_sum = run.sum;
+                have_ref = 1;
+            }
+            printf("\n");
+        }
+        free(d.text);
+        free(d.lines);
+    }
+    fclose(out);
+    printf("\nresults written to %s\n", out_path);
+    if (baseline) printf("%d regression(s) beyond %.1f%%\n", regressions, threshold);
+    return regressions ? 1 : 0;
+}
+
+
+// With --bench, runs the benchmarks instead of the tests (see bench_main).
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) return bench_main(argc - 2, argv + 2);
 
-int main(void) {
     printf("Running my_scanf tests...\n\n");
 
     test_basic_d_s_c();
@@ -864,9 +6721,32 @@ int main(void) {
     test_length_modifiers_d();
     test_f_float_double_longdouble();
     test_custom_q_b_r();
+    test_refill_boundary();
+    test_compile_exec();
+    test_ws_kernels();
+    test_scansets();
+    test_r_lines();
+    test_lookahead();
+    test_q_escapes();
+    test_suppress_skip();
+    test_alt();
+    test_intern();
+    test_arrays();
+    test_fixed_point();
+    test_d_ranges();
+    test_x_b_ranges();
+    test_f_exact();
+    test_threads_independent();
+    test_sources();
+    test_file_parallel();
+    test_records_batch();
+    test_views();
+    test_alloc_strings();
+    test_push();
+    test_stats();
 
     printf("\n---\nTests run: %d\nFailures:  %d\n", tests_run, tests_failed);
     return (tests_failed == 0) ? 0 : 1;
 }
 
-
+#endif /* MY_SCANF_NO_MAIN */
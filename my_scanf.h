@@ -0,0 +1,88 @@
+// Naomi Beck
+// my_scanf.h: what my_scanf.c and my_scanf.hpp share across the C ABI.
+//
+// The conversion spec (the kernels take it by pointer), the view and
+// array destinations, and the entry points the C++ header calls. Both
+// sides include this file, so the layouts cannot drift apart.
+#ifndef MY_SCANF_H
+#define MY_SCANF_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    LEN_NONE,
+    LEN_HH,
+    LEN_H,
+    LEN_L,
+    LEN_LL,
+    LEN_CAP_L
+} Length;
+
+typedef struct {
+    int width;      // 0 means “no width specified”
+    Length len;     // hh, h, l, ll, L
+    char conv;      // 'd','s','c','x','f','['; plus extensions q b r
+    int suppress;   // 0 = normal, 1 = assignment suppression via '*'
+    int view;       // 'v': %s/%q/%r/%[ store a ScanView into the input instead of copying
+    int alloc;      // 'm': %s/%q/%r/%[ store a char* to a copy in the context's arena
+    int intern;     // 'I': %s stores the token's ID in the context's intern table
+    int count;      // %N,d: an array of count elements; -1 (%*,d): count from a size_t * argument
+    char delim;     // array separator: one of , ; : | or '_' for whitespace only
+    int prec;       // '.N': %D keeps N fractional digits
+    unsigned char set[32];  // '[': the members, laid out for set_has (unused otherwise)
+} Spec;
+
+typedef struct ScanCtx ScanCtx;
+
+// Destination of a view conversion (%vs, %vq, %vr): the token's bytes in
+// the input, not NUL-terminated.
+typedef struct {
+    const char *ptr;
+    size_t len;
+} ScanView;
+
+// What a %*,d conversion stores through: the count in/out and the array.
+typedef struct {
+    size_t *n;
+    void *p;
+} ScanArray;
+
+ScanCtx *my_scanf_ctx_new(int fd);
+ScanCtx *my_scanf_ctx_new_mem(const char *data, size_t len);
+ScanCtx *my_scanf_ctx_open_mmap(const char *path);
+void my_scanf_ctx_free(ScanCtx *ctx);
+long my_scanf_ctx_intern(ScanCtx *ctx, const char *str, size_t len);
+const char *my_scanf_ctx_intern_str(ScanCtx *ctx, unsigned id, size_t *len);
+long my_scanf_intern(const char *str, size_t len);
+const char *my_scanf_intern_str(unsigned id, size_t *len);
+
+// Kernel entry points: one call per op of a format parsed at compile time.
+ScanCtx *my_scanf_k_begin(ScanCtx *ctx);
+int my_scanf_k_lit(ScanCtx *ctx, const char *lit, int len);
+void my_scanf_k_ws(ScanCtx *ctx);
+int my_scanf_k_c(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_s(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_d(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_x(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_f(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_q(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_b(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_r(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_vs(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_vq(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_vr(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_set(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_vset(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_is(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_array(ScanCtx *ctx, const Spec *sp, void *dst);
+int my_scanf_k_D(ScanCtx *ctx, const Spec *sp, void *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // MY_SCANF_H
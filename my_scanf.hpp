@@ -0,0 +1,354 @@
+// Naomi Beck
+// my_scanf.hpp: compile-time formats for C++20.
+//
+//   int n = msc::scan<"%d %s">(&x, buf);            // this thread's stdin
+//   int m = msc::scan_ctx<"%lf,%vs">(ctx, &v, &view);
+//
+// The format is parsed by constexpr code with the same rules as
+// my_scanf.c. A bad spec, a wrong argument count or an argument of the
+// wrong type is a compile error. Each format becomes a fixed sequence of
+// direct calls into the conversion kernels, with no varargs and no
+// format interpretation at run time.
+//
+// Link with my_scanf.c built with -DMY_SCANF_NO_MAIN.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Spec, ScanView, ScanArray and the kernel entry points, shared with my_scanf.c
+#include "my_scanf.h"
+
+namespace msc {
+
+using ::Length;
+using ::Spec;
+
+namespace detail {
+
+template <std::size_t N>
+struct Fmt {
+    char s[N]{};
+    constexpr Fmt(const char (&str)[N]) {
+        for (std::size_t i = 0; i < N; i++) s[i] = str[i];
+    }
+};
+
+enum class OpKind { Lit, Ws, Conv, Bad };
+
+struct Op {
+    OpKind kind = OpKind::Bad;
+    Spec sp{};
+    std::size_t lit = 0;        // Lit: offset of the text in the format
+    int lit_len = 0;
+};
+
+constexpr bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+constexpr bool is_array_delim(char c) {
+    return c == ',' || c == ';' || c == ':' || c == '|' || c == '_';
+}
+
+// conv_fn in my_scanf.c: which conversion / length / flag combinations exist
+constexpr bool valid(const Spec &sp) {
+    if (sp.prec != 0 && sp.conv != 'D') return false;
+    if (sp.count != 0) {
+        if (sp.view || sp.alloc || sp.intern) return false;
+        if (sp.conv == 'f') return sp.len == LEN_NONE || sp.len == LEN_L || sp.len == LEN_CAP_L;
+        return (sp.conv == 'd' || sp.conv == 'x' || sp.conv == 'b') && sp.len != LEN_CAP_L;
+    }
+    if (sp.intern) return sp.len == LEN_NONE && sp.conv == 's';
+    if (sp.view || sp.alloc) {
+        return sp.len == LEN_NONE && (sp.conv == 's' || sp.conv == 'q' || sp.conv == 'r' ||
+                                      sp.conv == 'R' || sp.conv == '[');
+    }
+    switch (sp.conv) {
+        case 'c': case 's': case 'q': case 'r': case 'R': return true;
+        case '[': return sp.len == LEN_NONE;
+        case 'd': case 'x': case 'b': return sp.len != LEN_CAP_L;
+        case 'f': return sp.len == LEN_NONE || sp.len == LEN_L || sp.len == LEN_CAP_L;
+        case 'D': return sp.len == LEN_NONE && sp.prec <= 18;
+        default: return false;
+    }
+}
+
+constexpr void set_add(unsigned char *set, int c) {
+    set[(c & 15) | (c >> 7) << 4] |= static_cast<unsigned char>(1u << ((c >> 4) & 7));
+}
+
+// parse_set in my_scanf.c: the scanset after "%[" into the nibble table;
+// false if there is no ']'
+constexpr bool parse_set(const char *f, std::size_t &q, unsigned char *set) {
+    auto at = [&](std::size_t i) { return static_cast<unsigned char>(f[i]); };
+    bool negate = false;
+    if (at(q) == '^') { negate = true; q++; }
+    if (at(q) == ']') set_add(set, at(q++));
+    while (at(q) && at(q) != ']') {
+        if (at(q + 1) == '-' && at(q + 2) && at(q + 2) != ']' && at(q) <= at(q + 2)) {
+            for (int c = at(q); c <= at(q + 2); c++) set_add(set, c);
+            q += 3;
+        } else {
+            set_add(set, at(q++));
+        }
+    }
+    if (at(q) != ']') return false;
+    if (negate) {
+        for (int i = 0; i < 32; i++) set[i] = static_cast<unsigned char>(~set[i]);
+    }
+    q++;
+    return true;
+}
+
+// next_op / parse_spec in my_scanf.c: decodes the op at f[p] and moves p past it
+constexpr Op next_op(const char *f, std::size_t &p) {
+    Op op;
+    if (f[p] == '%') {
+        std::size_t q = p + 1;
+        if (f[q] == '%') {
+            op.kind = OpKind::Lit;
+            op.lit = q;
+            op.lit_len = 1;
+            p = q + 1;
+            return op;
+        }
+        Spec sp{0, LEN_NONE, '\0', 0, 0, 0, 0, 0, '\0', 0, {}};
+        if (f[q] == '*' && is_array_delim(f[q + 1])) {
+            sp.count = -1;
+            sp.delim = f[q + 1];
+            q += 2;
+        } else if (f[q] == '*') {
+            sp.suppress = 1;
+            q++;
+        }
+        while (is_digit(f[q])) sp.width = sp.width * 10 + (f[q++] - '0');
+        if (sp.count == 0 && sp.width > 0 && is_array_delim(f[q])) {
+            sp.count = sp.width;
+            sp.width = 0;
+            sp.delim = f[q++];
+        }
+        if (f[q] == '.') {
+            q++;
+            while (is_digit(f[q])) sp.prec = sp.prec * 10 + (f[q++] - '0');
+        }
+        if (f[q] == 'v') { sp.view = 1; q++; }
+        else if (f[q] == 'm') { sp.alloc = 1; q++; }
+        else if (f[q] == 'I') { sp.intern = 1; q++; }
+        if (f[q] == 'h') {
+            q++;
+            if (f[q] == 'h') { sp.len = LEN_HH; q++; }
+            else sp.len = LEN_H;
+        } else if (f[q] == 'l') {
+            q++;
+            if (f[q] == 'l') { sp.len = LEN_LL; q++; }
+            else sp.len = LEN_L;
+        } else if (f[q] == 'L') {
+            sp.len = LEN_CAP_L;
+            q++;
+        }
+        if (f[q] == '\0') return op;            // Bad: dangling '%'
+        sp.conv = f[q++];
+        if (sp.conv == '[' && !parse_set(f, q, sp.set)) return op;  // Bad
+        if (!valid(sp)) return op;              // Bad
+        op.kind = OpKind::Conv;
+        op.sp = sp;
+        p = q;
+        return op;
+    }
+    if (is_space(f[p])) {
+        while (is_space(f[p])) p++;
+        op.kind = OpKind::Ws;
+        return op;
+    }
+    op.kind = OpKind::Lit;
+    op.lit = p;
+    while (f[p] && f[p] != '%' && !is_space(f[p])) p++;
+    op.lit_len = static_cast<int>(p - op.lit);
+    return op;
+}
+
+template <Fmt F>
+constexpr std::size_t count_ops() {
+    std::size_t p = 0, n = 0;
+    while (F.s[p]) {
+        n++;
+        if (next_op(F.s, p).kind == OpKind::Bad) break;
+    }
+    return n;
+}
+
+template <Fmt F>
+constexpr auto parse() {
+    std::array<Op, count_ops<F>()> ops{};
+    std::size_t p = 0;
+    for (auto &op : ops) op = next_op(F.s, p);
+    return ops;
+}
+
+template <Fmt F>
+inline constexpr auto ops = parse<F>();
+
+template <Fmt F>
+constexpr bool all_valid() {
+    for (const Op &op : ops<F>) {
+        if (op.kind == OpKind::Bad) return false;
+    }
+    return true;
+}
+
+// arguments op takes: a %*,d array takes the count and the array
+constexpr std::size_t op_args(const Op &op) {
+    if (op.kind != OpKind::Conv || op.sp.suppress) return 0;
+    return op.sp.count < 0 ? 2 : 1;
+}
+
+template <Fmt F>
+constexpr std::size_t nargs() {
+    std::size_t n = 0;
+    for (const Op &op : ops<F>) n += op_args(op);
+    return n;
+}
+
+// index of the (first) argument op I assigns to
+template <Fmt F, std::size_t I>
+constexpr std::size_t arg_index() {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < I; i++) n += op_args(ops<F>[i]);
+    return n;
+}
+
+template <class T>
+struct Is {
+    using type = T;
+};
+
+// the pointer type a conversion stores through (an array: its first element)
+template <Spec S>
+constexpr auto arg_type() {
+    if constexpr (S.view) return Is<ScanView *>{};
+    else if constexpr (S.intern) return Is<unsigned *>{};
+    else if constexpr (S.alloc) return Is<char **>{};
+    else if constexpr (S.conv == 'd') {
+        if constexpr (S.len == LEN_HH) return Is<signed char *>{};
+        else if constexpr (S.len == LEN_H) return Is<short *>{};
+        else if constexpr (S.len == LEN_L) return Is<long *>{};
+        else if constexpr (S.len == LEN_LL) return Is<long long *>{};
+        else return Is<int *>{};
+    } else if constexpr (S.conv == 'x' || S.conv == 'b') {
+        if constexpr (S.len == LEN_HH) return Is<unsigned char *>{};
+        else if constexpr (S.len == LEN_H) return Is<unsigned short *>{};
+        else if constexpr (S.len == LEN_L) return Is<unsigned long *>{};
+        else if constexpr (S.len == LEN_LL) return Is<unsigned long long *>{};
+        else return Is<unsigned *>{};
+    } else if constexpr (S.conv == 'D') {
+        return Is<std::int64_t *>{};
+    } else if constexpr (S.conv == 'f') {
+        if constexpr (S.len == LEN_L) return Is<double *>{};
+        else if constexpr (S.len == LEN_CAP_L) return Is<long double *>{};
+        else return Is<float *>{};
+    } else {
+        return Is<char *>{};    // c s q r R [
+    }
+}
+
+using Kernel = int (*)(ScanCtx *, const Spec *, void *);
+
+template <Spec S>
+constexpr Kernel kernel() {
+    if (S.intern) return my_scanf_k_is;
+    if (S.count != 0) return my_scanf_k_array;
+    if (S.view) {
+        switch (S.conv) {
+            case 's': return my_scanf_k_vs;
+            case 'q': return my_scanf_k_vq;
+            case '[': return my_scanf_k_vset;
+            default: return my_scanf_k_vr;    // r R
+        }
+    }
+    switch (S.conv) {
+        case 'c': return my_scanf_k_c;
+        case 's': return my_scanf_k_s;
+        case 'd': return my_scanf_k_d;
+        case 'x': return my_scanf_k_x;
+        case 'f': return my_scanf_k_f;
+        case 'q': return my_scanf_k_q;
+        case 'b': return my_scanf_k_b;
+        case 'D': return my_scanf_k_D;
+        case '[': return my_scanf_k_set;
+        default: return my_scanf_k_r;     // r R
+    }
+}
+
+template <Fmt F, std::size_t I, class Args>
+inline bool step(ScanCtx *ctx, const Args &args, int &assigned) {
+    constexpr Op op = ops<F>[I];
+    if constexpr (op.kind == OpKind::Lit) {
+        return my_scanf_k_lit(ctx, F.s + op.lit, op.lit_len);
+    } else if constexpr (op.kind == OpKind::Ws) {
+        my_scanf_k_ws(ctx);
+        return true;
+    } else {
+        static constexpr Spec sp = op.sp;
+        constexpr Kernel fn = kernel<sp>();
+        if constexpr (sp.suppress) {
+            return fn(ctx, &sp, nullptr);
+        } else if constexpr (sp.count < 0) {
+            constexpr std::size_t a = arg_index<F, I>();
+            using Want = typename decltype(arg_type<sp>())::type;
+            static_assert(std::is_same_v<std::tuple_element_t<a, Args>, std::size_t *>,
+                          "my_scanf: %*, takes a size_t * count before the array");
+            static_assert(std::is_same_v<std::tuple_element_t<a + 1, Args>, Want>,
+                          "my_scanf: argument type does not match its conversion");
+            ScanArray arr{std::get<a>(args), std::get<a + 1>(args)};
+            if (!fn(ctx, &sp, &arr)) return false;
+            assigned++;
+            return true;
+        } else {
+            constexpr std::size_t a = arg_index<F, I>();
+            using Want = typename decltype(arg_type<sp>())::type;
+            using Got = std::tuple_element_t<a, Args>;
+            static_assert(std::is_same_v<Got, Want>,
+                          "my_scanf: argument type does not match its conversion");
+            if (!fn(ctx, &sp, std::get<a>(args))) return false;
+            assigned++;
+            return true;
+        }
+    }
+}
+
+template <Fmt F, class... A, std::size_t... I>
+inline int run(ScanCtx *ctx, std::index_sequence<I...>, A... a) {
+    constexpr bool ok_fmt = all_valid<F>();
+    constexpr bool ok_count = !ok_fmt || sizeof...(A) == nargs<F>();
+    static_assert(ok_fmt, "my_scanf: bad conversion spec in format");
+    static_assert(ok_count, "my_scanf: wrong number of arguments for format");
+    if constexpr (ok_fmt && ok_count) {
+        if (!ctx) return 0;
+        const std::tuple<A...> args(a...);
+        int assigned = 0;
+        (void)(step<F, I>(ctx, args, assigned) && ...);
+        return assigned;
+    } else {
+        return 0;
+    }
+}
+
+}  // namespace detail
+
+// Scans this thread's stdin (the same input as my_scanf); returns the
+// number of successful assignments.
+template <detail::Fmt F, class... A>
+inline int scan(A... args) {
+    return detail::run<F>(my_scanf_k_begin(nullptr), std::make_index_sequence<detail::ops<F>.size()>{}, args...);
+}
+
+// Same, on a scanner context.
+template <detail::Fmt F, class... A>
+inline int scan_ctx(ScanCtx *ctx, A... args) {
+    return detail::run<F>(my_scanf_k_begin(ctx), std::make_index_sequence<detail::ops<F>.size()>{}, args...);
+}
+
+}  // namespace msc
@@ -0,0 +1,111 @@
+// my_scanf_hpp_test.cpp: checks for my_scanf.hpp, run by test_hpp.sh.
+//
+// Built normally, it checks the constexpr parser with static_asserts and
+// scans a few formats. Built with -DMSC_NEG=k, it holds negative case k,
+// a call that must not compile; test_hpp.sh expects each one to fail with
+// its static_assert message.
+
+#include "my_scanf.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace d = msc::detail;
+
+template <d::Fmt F, std::size_t I>
+using ArgT = typename decltype(d::arg_type<d::ops<F>[I].sp>())::type;
+
+// formats the parser accepts, and how many arguments they take
+static_assert(d::all_valid<"%d %s">() && d::nargs<"%d %s">() == 2);
+static_assert(d::all_valid<"id=%*d %31s %lf">() && d::nargs<"id=%*d %31s %lf">() == 2);
+static_assert(d::all_valid<"%*,d">() && d::nargs<"%*,d">() == 2);
+static_assert(d::all_valid<"%[^,],%vq %Is %.2D">() && d::nargs<"%[^,],%vq %Is %.2D">() == 4);
+static_assert(d::all_valid<"%%">() && d::nargs<"%%">() == 0);
+
+// formats it rejects, as conv_fn in my_scanf.c does
+static_assert(!d::all_valid<"%y">());
+static_assert(!d::all_valid<"%Ld">());
+static_assert(!d::all_valid<"%hhf">());
+static_assert(!d::all_valid<"%lvs">());
+static_assert(!d::all_valid<"%Id">());
+static_assert(!d::all_valid<"%.19D">());
+static_assert(!d::all_valid<"%.2Is">());
+static_assert(!d::all_valid<"%3,Is">());
+static_assert(!d::all_valid<"%*,Is">());
+static_assert(!d::all_valid<"%3,s">());
+static_assert(!d::all_valid<"%[abc">());
+
+// the pointer type each conversion stores through
+static_assert(std::is_same_v<ArgT<"%hhd", 0>, signed char *>);
+static_assert(std::is_same_v<ArgT<"%lx", 0>, unsigned long *>);
+static_assert(std::is_same_v<ArgT<"%Lf", 0>, long double *>);
+static_assert(std::is_same_v<ArgT<"%vs", 0>, ScanView *>);
+static_assert(std::is_same_v<ArgT<"%Is", 0>, unsigned *>);
+static_assert(std::is_same_v<ArgT<"%ms", 0>, char **>);
+static_assert(std::is_same_v<ArgT<"%.3D", 0>, std::int64_t *>);
+static_assert(std::is_same_v<ArgT<"%4,hhb", 0>, unsigned char *>);
+
+#ifndef MSC_NEG
+
+static int tests_failed = 0;
+
+static void check(const char *msg, bool ok) {
+    if (!ok) tests_failed++;
+    std::printf("%s: %s\n", ok ? "PASS" : "FAIL", msg);
+}
+
+int main() {
+    ScanCtx *ctx = my_scanf_ctx_new_mem("id=7 name 2.5\r\n", 15);
+    int id = 0;
+    char name[8];
+    double v = 0;
+    int n = msc::scan_ctx<"id=%d %7s %lf">(ctx, &id, name, &v);
+    check("hpp: ints, strings, doubles", n == 3 && id == 7 && std::strcmp(name, "name") == 0 && v == 2.5);
+    my_scanf_ctx_free(ctx);
+
+    ctx = my_scanf_ctx_new_mem("GET x GET 1,2,3 19.99", 21);
+    unsigned a, b;
+    int arr[3];
+    std::int64_t cents;
+    n = msc::scan_ctx<"%Is %*s %Is %3,d %.2D">(ctx, &a, &b, arr, &cents);
+    check("hpp: %Is, arrays, %.ND", n == 4 && a == b && arr[2] == 3 && cents == 1999);
+    my_scanf_ctx_free(ctx);
+
+    ctx = my_scanf_ctx_new_mem("4,5,6 x", 7);
+    int more[4];
+    std::size_t count = 4;
+    n = msc::scan_ctx<"%*,d">(ctx, &count, more);
+    check("hpp: %*,d", n == 1 && count == 3 && more[1] == 5);
+    my_scanf_ctx_free(ctx);
+
+    std::printf("Failures:  %d\n", tests_failed);
+    return tests_failed != 0;
+}
+
+#else
+
+int main() {
+    ScanCtx *ctx = my_scanf_ctx_new_mem("", 0);
+    int i;
+    long long ll;
+    char s[8];
+    int v[3];
+#if MSC_NEG == 1    // wrong type: int * for %ld
+    return msc::scan_ctx<"%ld">(ctx, &i);
+#elif MSC_NEG == 2  // too few arguments
+    return msc::scan_ctx<"%d %d">(ctx, &i);
+#elif MSC_NEG == 3  // too many arguments
+    return msc::scan_ctx<"%d">(ctx, &i, &ll);
+#elif MSC_NEG == 4  // bad conversion
+    return msc::scan_ctx<"%y">(ctx, &i);
+#elif MSC_NEG == 5  // %Is stores an ID, not the text
+    return msc::scan_ctx<"%Is">(ctx, s);
+#elif MSC_NEG == 6  // %*,d wants a size_t * count
+    return msc::scan_ctx<"%*,d">(ctx, &i, v);
+#elif MSC_NEG == 7  // %.ND stores an int64_t
+    return msc::scan_ctx<"%.2D">(ctx, &i);
+#endif
+}
+
+#endif
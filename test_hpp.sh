@@ -0,0 +1,48 @@
+#!/bin/sh
+# Compile-time tests of my_scanf.hpp (C++20).
+# Builds my_scanf_hpp_test.cpp against my_scanf.c and runs it, then
+# compiles each negative case in it and expects the build to fail with
+# the matching static_assert message. CC and CXX may be overridden.
+#
+#   sh test_hpp.sh
+
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+here=$(dirname "$0")
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+failed=0
+
+$CC -O2 -c -DMY_SCANF_NO_MAIN "$here/my_scanf.c" -o "$tmp/my_scanf.o" || exit 1
+if $CXX -std=c++20 -Wall -Wextra -I"$here" "$here/my_scanf_hpp_test.cpp" "$tmp/my_scanf.o" \
+        -pthread -lm -o "$tmp/hpp_test"; then
+    "$tmp/hpp_test" || failed=$((failed + 1))
+else
+    echo "FAIL: my_scanf_hpp_test.cpp does not compile"
+    failed=$((failed + 1))
+fi
+
+# negative case number and the static_assert message it must produce
+neg() {
+    if $CXX -std=c++20 -fsyntax-only -I"$here" -DMSC_NEG="$1" "$here/my_scanf_hpp_test.cpp" \
+            2>"$tmp/err"; then
+        echo "FAIL: negative case $1 compiled"
+        failed=$((failed + 1))
+    elif grep -qF "$2" "$tmp/err"; then
+        echo "PASS: negative case $1 rejected: $2"
+    else
+        echo "FAIL: negative case $1 rejected without \"$2\""
+        failed=$((failed + 1))
+    fi
+}
+
+neg 1 "argument type does not match its conversion"
+neg 2 "wrong number of arguments for format"
+neg 3 "wrong number of arguments for format"
+neg 4 "bad conversion spec in format"
+neg 5 "argument type does not match its conversion"
+neg 6 "takes a size_t * count before the array"
+neg 7 "argument type does not match its conversion"
+
+echo "hpp failures: $failed"
+[ "$failed" -eq 0 ]